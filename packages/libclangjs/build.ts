@@ -52,6 +52,12 @@ const copyReadme = async () => {
   fs.copyFileSync(path.join(workspaceDir, "README.md"), "README.md")
 };
 
+const buildStdlibPch = () => {
+  const res = exec("ts-node buildStdlibPch.ts", { cwd: __dirname });
+  if (res.code !== 0) throw new Error(res.stderr);
+};
+
 configureAndRunBuild("node");
+buildStdlibPch();
 configureAndRunBuild("web");
 copyReadme();
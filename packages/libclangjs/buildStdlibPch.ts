@@ -0,0 +1,113 @@
+import { exec } from "shelljs";
+import path from "path";
+import fs from "fs";
+import init from "./node";
+
+// Precompiles the C and C++ standard library headers of the Emscripten sysroot
+// into PCH bundles, which can be loaded with CXIndex_setPchBundle. Consumers
+// need to mount the same headers at the same paths, i.e. the include
+// directory of the sysroot at /sysroot and the clang builtin headers at /builtins.
+
+const outputPath = path.join(__dirname, "stdlib-pch");
+
+const cxxHeaders = [
+  "algorithm", "array", "atomic", "bitset", "cassert", "cctype", "cmath",
+  "cstddef", "cstdint", "cstdio", "cstdlib", "cstring", "chrono", "deque",
+  "exception", "functional", "initializer_list", "iomanip", "iostream",
+  "iterator", "limits", "list", "map", "memory", "mutex", "numeric", "optional",
+  "queue", "set", "sstream", "stack", "stdexcept", "string", "string_view",
+  "tuple", "type_traits", "unordered_map", "unordered_set", "utility",
+  "variant", "vector",
+];
+const cHeaders = [
+  "assert.h", "ctype.h", "errno.h", "float.h", "limits.h", "math.h",
+  "stdarg.h", "stdbool.h", "stddef.h", "stdint.h", "stdio.h", "stdlib.h",
+  "string.h", "time.h",
+];
+
+const bundles = [
+  { name: "c++17", headers: cxxHeaders, extension: ".hpp", args: ["-std=c++17"] },
+  { name: "c11", headers: cHeaders, extension: ".h", args: ["-std=c11"] },
+];
+
+const baseArgs = [
+  "-target", "wasm32-unknown-emscripten",
+  "-nostdinc",
+  "-isystem", "/sysroot/c++/v1",
+  "-isystem", "/builtins",
+  "-isystem", "/sysroot",
+];
+
+const emscriptenCache = () => {
+  const res = exec("em-config CACHE", { silent: true });
+  if (res.code !== 0) throw new Error(res.stderr);
+  return res.stdout.trim();
+};
+
+const emscriptenVersion = () => {
+  const res = exec("emcc -dumpversion", { silent: true });
+  if (res.code !== 0) throw new Error(res.stderr);
+  return res.stdout.trim();
+};
+
+const main = async () => {
+  const clang = await init();
+  const clangPath = path.join(__dirname, "node_modules", "llvm-project-emscripten", "dist", "lib", "clang");
+  const clangVersion = fs.readdirSync(clangPath)[0];
+
+  fs.rmSync(outputPath, { recursive: true, force: true });
+  fs.mkdirSync(outputPath, { recursive: true });
+  for (const [root, mountPoint] of [
+    [path.join(emscriptenCache(), "sysroot", "include"), "/sysroot"],
+    [path.join(clangPath, clangVersion, "include"), "/builtins"],
+    [outputPath, "/stdlib-pch"],
+  ]) {
+    clang.FS.mkdir(mountPoint);
+    clang.FS.mount(clang.NODEFS, { root }, mountPoint);
+  }
+
+  const index = clang.createIndex(0, 0);
+  const manifest = {
+    clangVersion,
+    emscriptenVersion: emscriptenVersion(),
+    bundles: [] as { name: string, file: string, headers: string[], args: string[] }[],
+  };
+  for (const bundle of bundles) {
+    // The header is passed as an unsaved file, so that it need not exist when
+    // the bundle is loaded.
+    const headerFile = `/stdlib-pch/${bundle.name}${bundle.extension}`;
+    const unsavedFiles = [{ filename: headerFile, contents: bundle.headers.map(h => `#include <${h}>\n`).join("") }];
+    const file = `${bundle.name}.pch`;
+    const args = [...baseArgs, ...bundle.args];
+    const tu = clang.parseTranslationUnit(index, headerFile, [...args, "-Xclang", "-fno-pch-timestamp"], unsavedFiles,
+      clang.CXTranslationUnit_Flags.Incomplete.value | clang.CXTranslationUnit_Flags.ForSerialization.value);
+    if (clang.isNullPointer(tu)) throw new Error(`Cannot parse the headers of bundle ${bundle.name}`);
+    const saveError = clang.saveTranslationUnit(tu, `/stdlib-pch/${file}`, clang.defaultSaveOptions(tu));
+    clang.disposeTranslationUnit(tu);
+    if (saveError !== clang.CXSaveError.None.value) throw new Error(`Cannot save bundle ${bundle.name}`);
+
+    // Source files parsed with the bundle include its headers again, which
+    // must be harmless, i.e. the headers need include guards.
+    const checkFile = `/stdlib-pch/${bundle.name}-check${bundle.extension}`;
+    const checkTu = clang.parseTranslationUnit(index, checkFile, [...args, "-include-pch", `/stdlib-pch/${file}`],
+      [{ filename: checkFile, contents: unsavedFiles[0].contents }], 0);
+    if (clang.isNullPointer(checkTu)) throw new Error(`Cannot parse with bundle ${bundle.name}`);
+    const errors: string[] = [];
+    for (let i = 0; i < clang.getNumDiagnostics(checkTu); i++) {
+      const diagnostic = clang.getDiagnostic(checkTu, i);
+      if (clang.getDiagnosticSeverity(diagnostic).value >= clang.CXDiagnosticSeverity.Error.value) {
+        errors.push(clang.getDiagnosticSpelling(diagnostic));
+      }
+      clang.disposeDiagnostic(diagnostic);
+    }
+    clang.disposeTranslationUnit(checkTu);
+    if (errors.length > 0) throw new Error(`Headers of bundle ${bundle.name} cannot be included again:\n${errors.join("\n")}`);
+
+    manifest.bundles.push({ name: bundle.name, file, headers: bundle.headers.map(h => `<${h}>`), args });
+  }
+  clang.disposeIndex(index);
+  fs.writeFileSync(path.join(outputPath, "manifest.json"), JSON.stringify(manifest, null, 2));
+  clang.PThread.terminateAllThreads();
+};
+
+main();
@@ -7,3 +7,4 @@ fs.rmSync("web.js", { force: true });
 fs.rmSync("web.worker.js", { force: true });
 fs.rmSync("libclang.wasm", { force: true });
 fs.rmSync("README.md", { force: true });
+fs.rmSync("stdlib-pch", { recursive: true, force: true });
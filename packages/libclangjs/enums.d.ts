@@ -29,6 +29,85 @@ export type CXChildVisitResult = {
   Recurse: EnumValue<CXChildVisitResult>;
 };
 
+/**
+ * Selects the columns produced by {@link LibClang.exportCursorTree | exportCursorTree()}.
+ *
+ * The values are meant to be bitwise ORed together.
+ */
+export type CursorTreeField = {
+  /**
+   * The {@link CXCursorKind} value of each cursor.
+   */
+  Kind: EnumValue<CursorTreeField>;
+
+  /**
+   * The index of each cursor's parent, or -1 for direct children of the root.
+   */
+  Parent: EnumValue<CursorTreeField>;
+
+  /**
+   * The depth of each cursor, starting at 1 for direct children of the root.
+   */
+  Depth: EnumValue<CursorTreeField>;
+
+  /**
+   * The index into the file table of the file containing each cursor.
+   */
+  File: EnumValue<CursorTreeField>;
+
+  /**
+   * The start and end file offsets of each cursor's extent.
+   */
+  Offsets: EnumValue<CursorTreeField>;
+
+  /**
+   * The index into the string table of each cursor's spelling.
+   */
+  Spelling: EnumValue<CursorTreeField>;
+
+  /**
+   * All of the above.
+   */
+  All: EnumValue<CursorTreeField>;
+};
+
+/**
+ * Error codes returned by libclang routines.
+ *
+ * Zero (`Success`) is the only error code indicating success.  Other
+ * error codes, including not yet assigned non-zero values, indicate errors.
+ */
+export type CXErrorCode = {
+  /**
+   * No error.
+   */
+  Success: EnumValue<CXErrorCode>;
+
+  /**
+   * A generic error code, no further details are available.
+   *
+   * Errors of this kind can get their own specific error codes in future
+   * libclang versions.
+   */
+  Failure: EnumValue<CXErrorCode>;
+
+  /**
+   * libclang crashed while performing the requested operation.
+   */
+  Crashed: EnumValue<CXErrorCode>;
+
+  /**
+   * The function detected that the arguments violate the function
+   * contract.
+   */
+  InvalidArguments: EnumValue<CXErrorCode>;
+
+  /**
+   * An AST deserialization error has occurred.
+   */
+  ASTReadError: EnumValue<CXErrorCode>;
+};
+
 export type CXGlobalOptFlags = {
   /**
    * Used to indicate that no special CXIndex options are needed.
@@ -1933,6 +2012,46 @@ export type CXCompletionChunkKind = {
   VerticalSpace: EnumValue<CXCompletionChunkKind>;
 };
 
+/**
+ * Flags that can be passed to {@link LibClang.codeCompleteAt | codeCompleteAt()} to
+ * modify its behavior.
+ *
+ * The enumerators in this enumeration can be bitwise-OR'd together to
+ * provide multiple options to {@link LibClang.codeCompleteAt | codeCompleteAt()}.
+ */
+export type CXCodeComplete_Flags = {
+  /**
+   * Whether to include macros within the set of code
+   * completions returned.
+   */
+  IncludeMacros: EnumValue<CXCodeComplete_Flags>;
+
+  /**
+   * Whether to include code patterns for language constructs
+   * within the set of code completions, e.g., for loops.
+   */
+  IncludeCodePatterns: EnumValue<CXCodeComplete_Flags>;
+
+  /**
+   * Whether to include brief documentation within the set of code
+   * completions returned.
+   */
+  IncludeBriefComments: EnumValue<CXCodeComplete_Flags>;
+
+  /**
+   * Whether to speed up completion by omitting top- or namespace-level entities
+   * defined in the preamble. There's no guarantee any particular entity is
+   * omitted. This may be useful if the headers are indexed externally.
+   */
+  SkipPreamble: EnumValue<CXCodeComplete_Flags>;
+
+  /**
+   * Whether to include completions with small
+   * fix-its, e.g. change '.' to '->' on member access, etc.
+   */
+  IncludeCompletionsWithFixIts: EnumValue<CXCodeComplete_Flags>;
+};
+
 export type CXVisitorResult = {
   Break: EnumValue<CXVisitorResult>;
   Continue: EnumValue<CXVisitorResult>;
@@ -2040,3 +2159,56 @@ export type CXSymbolRole = {
   AddressO: EnumValue<CXSymbolRole>;
   Implicit: EnumValue<CXSymbolRole>;
 };
+
+export type CXIndexOptFlags = {
+  /**
+   * Used to indicate that no special indexing options are needed.
+   */
+  None: EnumValue<CXIndexOptFlags>;
+
+  /**
+   * Used to indicate that IndexerCallbacks#indexEntityReference should
+   * be invoked for only one reference of an entity per source file that does
+   * not also include a declaration/definition of the entity.
+   */
+  SuppressRedundantRefs: EnumValue<CXIndexOptFlags>;
+
+  /**
+   * Function-local symbols should be indexed. If this is not set
+   * function-local symbols will be ignored.
+   */
+  IndexFunctionLocalSymbols: EnumValue<CXIndexOptFlags>;
+
+  /**
+   * Implicit function/class template instantiations should be indexed.
+   * If this is not set, implicit instantiations will be ignored.
+   */
+  IndexImplicitTemplateInstantiations: EnumValue<CXIndexOptFlags>;
+
+  /**
+   * Suppress all compiler warnings when parsing for indexing.
+   */
+  SuppressWarnings: EnumValue<CXIndexOptFlags>;
+
+  /**
+   * Skip a function/method body that was already parsed during an
+   * indexing session associated with a \c CXIndexAction object.
+   * Bodies in system headers are always skipped.
+   */
+  SkipParsedBodiesInSession: EnumValue<CXIndexOptFlags>;
+};
+
+/**
+ * The kinds of events in {@link IndexEvents}.
+ */
+export type IndexEventKind = {
+  /**
+   * A declaration or definition of an entity.
+   */
+  Declaration: EnumValue<IndexEventKind>;
+
+  /**
+   * A reference to an entity.
+   */
+  Reference: EnumValue<IndexEventKind>;
+};
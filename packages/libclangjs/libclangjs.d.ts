@@ -1,10 +1,12 @@
 import { EmscriptenModule, FS } from "./emscripten";
-import { CXAvailabilityKind, CXCallingConv, CXChildVisitResult, CXCompletionChunkKind, CXCursorKind, CXDiagnosticSeverity, CXGlobalOptFlags, CXIdxAttrKind, CXIdxDeclInfoFlags, CXIdxEntityCXXTemplateKind, CXIdxEntityKind, CXIdxEntityLanguage, CXIdxEntityRefKind, CXIdxObjCContainerKind, CXLanguageKind, CXLinkageKind, CXLoadDiag_Error, CXNameRefFlags, CXObjCDeclQualifierKind, CXObjCPropertyAttrKind, CXPrintingPolicyProperty, CXRefQualifierKind, CXReparse_Flags, CXResult, CXSaveError, CXSaveTranslationUnit_Flags, CXSymbolRole, CXTLSKind, CXTUResourceUsageKind, CXTemplateArgumentKind, CXTokenKind, CXTranslationUnit_Flags, CXTypeKind, CXTypeLayoutError, CXTypeNullabilityKind, CXVisibilityKind, CXVisitorResult, CX_CXXAccessSpecifier, CX_StorageClass, EnumValue } from "./enums";
-import { CXCursor, CXDiagnostic, CXDiagnosticSet, CXFile, CXIndex, CXModule, CXPrintingPolicy, CXSourceLocation, CXSourceRange, CXToken, CXTranslationUnit, CXType, CXUnsavedFile } from "./structs";
+import { CursorTreeField, CXAvailabilityKind, CXCallingConv, CXChildVisitResult, CXCodeComplete_Flags, CXCompletionChunkKind, CXCursorKind, CXDiagnosticSeverity, CXErrorCode, CXGlobalOptFlags, CXIdxAttrKind, CXIdxDeclInfoFlags, CXIdxEntityCXXTemplateKind, CXIdxEntityKind, CXIdxEntityLanguage, CXIdxEntityRefKind, CXIdxObjCContainerKind, CXIndexOptFlags, CXLanguageKind, CXLinkageKind, CXLoadDiag_Error, CXNameRefFlags, CXObjCDeclQualifierKind, CXObjCPropertyAttrKind, CXPrintingPolicyProperty, CXRefQualifierKind, CXReparse_Flags, CXResult, CXSaveError, CXSaveTranslationUnit_Flags, CXSymbolRole, CXTLSKind, CXTUResourceUsageKind, CXTemplateArgumentKind, CXTokenKind, CXTranslationUnit_Flags, CXTypeKind, CXTypeLayoutError, CXTypeNullabilityKind, CXVisibilityKind, CXVisitorResult, CX_CXXAccessSpecifier, CX_StorageClass, EnumValue, IndexEventKind } from "./enums";
+import { BindingProfileEntry, BindingTrace, CodeCompletionSession, CompletionList, CursorFilter, CursorTree, CXCursor, CXDiagnostic, CXDiagnosticSet, CXFile, CXIndex, CXIndexAction, CXModule, CXPrintingPolicy, CXSourceLocation, CXSourceRange, CXToken, CXTranslationUnit, CXType, CXUnsavedFile, HeapStats, IndexEvents, IndexResourceUsage, IndexingSession, IndexingSessionStats, SymbolIndex, SymbolLocations, TokenList, TranslationUnitCache, TranslationUnitCacheStats, TUResourceUsage, UnsavedFileStore } from "./structs";
+import { RawLibClang } from "./raw";
 
 export * from "./emscripten";
 export * from "./enums";
 export * from "./structs";
+export * from "./raw";
 
 /**
  * Visitor invoked for each cursor found by a traversal.
@@ -20,6 +22,28 @@ export * from "./structs";
  */
 type CXCursorVisitor = (cursor: CXCursor, parent: CXCursor) => EnumValue<CXChildVisitResult>;
 
+/**
+ * Visitor invoked with a batch of cursors found by
+ * {@link LibClang.visitChildrenBatched | visitChildrenBatched()}.
+ *
+ * `cursors[i]` is a child of `parents[i]`. The visitor returns one
+ * {@link CXChildVisitResult} value (e.g. `CXChildVisitResult.Recurse.value`)
+ * per cursor. Missing entries, or no return value at all, mean `Recurse`.
+ */
+type CXCursorBatchVisitor = (cursors: CXCursor[], parents: CXCursor[]) => ArrayLike<number> | void;
+
+/**
+ * Options for initializing libclangjs.
+ */
+export type LibClangOptions = Partial<EmscriptenModule> & {
+  /**
+   * Records call counts, times and marshalled bytes of all bound functions,
+   * see {@link LibClang.getBindingProfile | getBindingProfile()}. Bound
+   * functions are not wrapped unless this is set.
+   */
+  libclangjsProfiling?: boolean;
+};
+
 export type LibClang = EmscriptenModule & {
   /**
    * Provides a shared context for creating translation units.
@@ -103,6 +127,53 @@ export type LibClang = EmscriptenModule & {
    */
   CXIndex_setInvocationEmissionPathOption: (index: CXIndex, path: string | null) => void;
 
+  /**
+   * Sets a directory, e.g. on a NODEFS mount, in which precompiled preambles
+   * are kept across processes. A null value (default) disables the cache.
+   *
+   * When set, parsing a source file through {@link LibClang.parseTranslationUnit | parseTranslationUnit()},
+   * {@link LibClang.parseTranslationUnitAsync | parseTranslationUnitAsync()} or {@link LibClang.parseMany | parseMany()}
+   * precompiles its preamble, i.e. the leading #include, #import, #define,
+   * #undef and #pragma directives, into this directory. The PCH file is keyed
+   * by a hash of the preamble and the command line arguments and reused via
+   * `-include-pch` by later parses. It is rebuilt once if it cannot be used,
+   * e.g. because one of its headers has changed, and not used again for the
+   * lifetime of the module if the rebuilt PCH cannot be used either.
+   *
+   * The includes of the preamble are processed again by parses with the PCH,
+   * so preambles including a header without an include guard or
+   * `#pragma once` are not precompiled. The first parse with a PCH which has
+   * errors is compared to a parse without it. If the PCH adds errors, that
+   * parse is returned instead and the PCH is not used again.
+   *
+   * The directory must exist.
+   */
+  CXIndex_setPreambleCacheDirectory: (index: CXIndex, path: string | null) => void;
+
+  /**
+   * Loads precompiled header bundles, e.g. for the standard library headers,
+   * from the `manifest.json` written by the libclangjs build into
+   * `stdlib-pch/`. A null value (default) unloads all bundles.
+   *
+   * A bundle is used when the preamble of a parsed source file consists of
+   * #include directives only, all of them naming headers of the bundle, and
+   * when the command line arguments of the bundle appear in the same order on
+   * the command line of the parse. Bundles take precedence over the preamble
+   * cache set via {@link LibClang.CXIndex_setPreambleCacheDirectory | CXIndex_setPreambleCacheDirectory()}.
+   *
+   * The prebuilt bundles expect the include directory of the Emscripten
+   * sysroot to be mounted at `/sysroot` and the clang builtin headers at
+   * `/builtins`.
+   *
+   * As with the preamble cache, the first parse with a bundle which has errors
+   * is compared to a parse without it, and a bundle which adds errors is not
+   * used again.
+   *
+   * @returns false if the manifest cannot be read or is malformed, in which
+   * case the bundles of the index are left unchanged.
+   */
+  CXIndex_setPchBundle: (index: CXIndex, manifestPath: string | null) => boolean;
+
   /**
    * Retrieve the complete file and path name of the given file.
    */
@@ -419,16 +490,46 @@ export type LibClang = EmscriptenModule & {
    */
   getChildDiagnostics: (D: CXDiagnostic) => CXDiagnosticSet;
 
-  // skipped getNumDiagnostics
-  // skipped getDiagnostic
+  /**
+   * Determine the number of diagnostics produced for the given
+   * translation unit.
+   */
+  getNumDiagnostics: (Unit: CXTranslationUnit) => number;
+
+  /**
+   * Retrieve a diagnostic associated with the given translation unit.
+   *
+   * @param Unit the translation unit to query.
+   * @param Index the zero-based diagnostic number to retrieve.
+   *
+   * @returns the requested diagnostic. This diagnostic must be freed
+   * via a call to {@link LibClang.disposeDiagnostic | disposeDiagnostic()}.
+   */
+  getDiagnostic: (Unit: CXTranslationUnit, Index: number) => CXDiagnostic;
+
   // skipped getDiagnosticSetFromTU
-  // skipped disposeDiagnostic
+
+  /**
+   * Destroy a diagnostic.
+   */
+  disposeDiagnostic: (Diagnostic: CXDiagnostic) => void;
+
   // skipped CXDiagnosticDisplayOptions
   // skipped formatDiagnostic
   // skipped defaultDiagnosticDisplayOptions
-  // skipped getDiagnosticSeverity
+
+  /**
+   * Determine the severity of the given diagnostic.
+   */
+  getDiagnosticSeverity: (Diagnostic: CXDiagnostic) => EnumValue<CXDiagnosticSeverity>;
+
   // skipped getDiagnosticLocation
-  // skipped getDiagnosticSpelling
+
+  /**
+   * Retrieve the text of the given diagnostic.
+   */
+  getDiagnosticSpelling: (Diagnostic: CXDiagnostic) => string;
+
   // skipped getDiagnosticOption
   // skipped getDiagnosticCategory
   // skipped getDiagnosticCategoryName
@@ -483,7 +584,7 @@ export type LibClang = EmscriptenModule & {
    * CXUnsavedFile) are copied when necessary, so the client only needs to
    * guarantee their validity until the call to this function returns.
    */
-  createTranslationUnitFromSourceFile: (CIdx: CXIndex, source_filename: null | string, command_line_args: string[] | null, unsaved_files: CXUnsavedFile[] | null) => CXTranslationUnit;
+  createTranslationUnitFromSourceFile: (CIdx: CXIndex, source_filename: null | string, command_line_args: string[] | null, unsaved_files: CXUnsavedFile[] | UnsavedFileStore | null) => CXTranslationUnit;
 
   /**
    * Same as {@link LibClang.createTranslationUnit2 | createTranslationUnit2}, but returns
@@ -507,7 +608,7 @@ export type LibClang = EmscriptenModule & {
    * preamble) geared toward improving the performance of these routines. The
    * set of optimizations enabled may change from one version to the next.
    */
-  defaultEditingTranslationUnitOptions: () => void;
+  defaultEditingTranslationUnitOptions: () => number;
 
   /**
    * Same as `parseTranslationUnit2`, but returns
@@ -515,7 +616,48 @@ export type LibClang = EmscriptenModule & {
    * routine returns a `NULL` `CXTranslationUnit`, without further detailed
    * error codes.
    */
-  parseTranslationUnit: (CIdx: CXIndex, source_filename: string | null, command_line_args: string[] | null, unsaved_files: CXUnsavedFile[] | null, options: number) => CXTranslationUnit;
+  parseTranslationUnit: (CIdx: CXIndex, source_filename: string | null, command_line_args: string[] | null, unsaved_files: CXUnsavedFile[] | UnsavedFileStore | null, options: number) => CXTranslationUnit;
+
+  /**
+   * Same as {@link LibClang.parseTranslationUnit | parseTranslationUnit()}, but
+   * parses on a thread of the pool and leaves the calling thread responsive.
+   *
+   * Asynchronous jobs share a queue, which is worked off by at most half of
+   * the threads of the pool less one, since libclang parses on a thread of its
+   * own and a thread is kept for parses on the calling thread. Further jobs
+   * wait for a worker.
+   *
+   * Arguments are copied before this function returns, including a snapshot
+   * of an {@link UnsavedFileStore}, so they may be modified while parsing.
+   *
+   * @returns A promise for the translation unit and a {@link CXErrorCode}
+   * value. The translation unit is a null pointer unless the error code is
+   * `CXErrorCode.Success`.
+   */
+  parseTranslationUnitAsync: (CIdx: CXIndex, source_filename: string | null, command_line_args: string[] | null, unsaved_files: CXUnsavedFile[] | UnsavedFileStore | null, options: number) => Promise<{ tu: CXTranslationUnit, errorCode: number }>;
+
+  /**
+   * Parse many translation units in parallel on the thread pool.
+   *
+   * Each worker picks up the next pending job as soon as it has finished its
+   * previous one. All arguments are copied before this function returns. The
+   * workers are those of
+   * {@link LibClang.parseTranslationUnitAsync | parseTranslationUnitAsync()}.
+   *
+   * @param jobs The source file, command line arguments and unsaved files of
+   * each translation unit, as they would be passed to
+   * {@link LibClang.parseTranslationUnit | parseTranslationUnit()}.
+   *
+   * @param options `options` is a bitset of {@link CXTranslationUnit_Flags}
+   * applied to every job (0 by default). `threads` is the number of
+   * translation units parsed at the same time. It defaults to, and is limited
+   * to, the number of workers not busy with other asynchronous jobs, and is at
+   * least 1.
+   *
+   * @returns A promise for the translation unit and the {@link CXErrorCode}
+   * value of each job, in the order of `jobs`.
+   */
+  parseMany: (CIdx: CXIndex, jobs: { file: string | null, args?: string[] | null, unsavedFiles?: CXUnsavedFile[] | UnsavedFileStore | null }[], options: { options?: number, threads?: number } | null) => Promise<{ tu: CXTranslationUnit, errorCode: number }[]>;
 
   // skipped parseTranslationUnit2
   // skipped parseTranslationUnit2FullArgv
@@ -553,6 +695,9 @@ export type LibClang = EmscriptenModule & {
    * @returns A value that will match one of the enumerators of the CXSaveError
    * enumeration. Zero (CXSaveError_None) indicates that the translation unit was
    * saved successfully, while a non-zero value indicates that a problem occurred.
+   * `CXSaveError.InvalidTU` is returned without saving while a
+   * {@link LibClang.reparseTranslationUnitAsync | reparseTranslationUnitAsync()}
+   * of the translation unit is pending.
    */
   saveTranslationUnit: (TU: CXTranslationUnit, FileName: string | null, options: number) => number;
 
@@ -562,11 +707,18 @@ export type LibClang = EmscriptenModule & {
   * A suspended translation unit uses significantly less memory but on the other
   * side does not support any other calls than {@link LibClang.reparseTranslationUnit | reparseTranslationUnit}
   * to resume it or {@link LibClang.disposeTranslationUnit | disposeTranslationUnit} to dispose it completely.
+  *
+  * Returns 0 without suspending while a
+  * {@link LibClang.reparseTranslationUnitAsync | reparseTranslationUnitAsync()}
+  * of the translation unit is pending.
   */
   suspendTranslationUnit: (TU: CXTranslationUnit) => number;
 
   /**
   * Destroy the specified CXTranslationUnit object.
+  *
+  * While a {@link LibClang.reparseTranslationUnitAsync | reparseTranslationUnitAsync()}
+  * of the translation unit is pending, it is destroyed once that has finished.
   */
   disposeTranslationUnit: (TU: CXTranslationUnit) => void;
 
@@ -620,8 +772,130 @@ export type LibClang = EmscriptenModule & {
    * invalid. In such cases, the only valid call for TU is
    * {@link LibClang.disposeTranslationUnit | disposeTranslationUnit(TU)}.  The error codes returned by this
    * routine are described by the {@link CXErrorCode} enum.
+   * `CXErrorCode.InvalidArguments` is returned without reparsing while a
+   * {@link LibClang.reparseTranslationUnitAsync | reparseTranslationUnitAsync()}
+   * of the translation unit is pending.
+   */
+  reparseTranslationUnit: (TU: CXTranslationUnit, unsaved_files: CXUnsavedFile[] | UnsavedFileStore | null, options: number) => number;
+
+  /**
+   * Same as {@link LibClang.reparseTranslationUnit | reparseTranslationUnit()},
+   * but reparses on a thread of the pool and leaves the calling thread
+   * responsive.
+   *
+   * The translation unit must not be used until the returned promise settles.
+   * Until then, reparsing, suspending or saving it fails, and disposing it is
+   * deferred until the reparse has finished. A second asynchronous reparse
+   * resolves with `CXErrorCode.InvalidArguments` right away.
+   *
+   * @returns A promise for the value {@link LibClang.reparseTranslationUnit | reparseTranslationUnit()}
+   * would have returned.
+   */
+  reparseTranslationUnitAsync: (TU: CXTranslationUnit, unsaved_files: CXUnsavedFile[] | UnsavedFileStore | null, options: number) => Promise<number>;
+
+  /**
+   * Create a cache of translation units for the given index, keyed by source
+   * file, command line arguments and parse options.
+   *
+   * The memory of each translation unit is measured with libclang's resource
+   * usage. When all cached translation units take more than \p budget bytes,
+   * the least recently used ones are suspended first and disposed after
+   * that. Translation units which are in use, i.e. returned by
+   * {@link LibClang.TranslationUnitCache_get | TranslationUnitCache_get()} and
+   * not yet released, are left alone, so the budget may be exceeded while
+   * they are in use.
+   *
+   * The cache must be released with
+   * {@link LibClang.disposeTranslationUnitCache | disposeTranslationUnitCache()},
+   * which disposes all cached translation units.
+   */
+  createTranslationUnitCache: (CIdx: CXIndex, budget: number) => TranslationUnitCache;
+
+  /**
+   * Destroy the given cache and all translation units in it.
+   */
+  disposeTranslationUnitCache: (cache: TranslationUnitCache) => void;
+
+  /**
+   * Return the cached translation unit for a source file, parsing it on a
+   * miss as {@link LibClang.parseTranslationUnit | parseTranslationUnit()}
+   * would. A cached translation unit is reparsed with \p unsaved_files if it
+   * is suspended or if the unsaved files differ from those of its last parse.
+   * If it differs but is still in use, i.e. returned and not yet released, a
+   * separate translation unit is parsed, which is not cached and is disposed
+   * once released. Changes to files on disk are not detected.
+   *
+   * The returned translation unit is owned by the cache and must not be
+   * disposed. It stays valid until it is released with
+   * {@link LibClang.TranslationUnitCache_release | TranslationUnitCache_release()},
+   * once for each call of this function which returned it.
+   *
+   * @returns A null pointer if the source file cannot be parsed.
+   */
+  TranslationUnitCache_get: (cache: TranslationUnitCache, source_filename: string, command_line_args: string[] | null, unsaved_files: CXUnsavedFile[] | UnsavedFileStore | null, options: number) => CXTranslationUnit;
+
+  /**
+   * Retrieve the hit rate, memory and eviction statistics of a cache.
+   */
+  TranslationUnitCache_getStats: (cache: TranslationUnitCache) => TranslationUnitCacheStats;
+
+  /**
+   * Release a translation unit returned by
+   * {@link LibClang.TranslationUnitCache_get | TranslationUnitCache_get()}, after
+   * which the cache may suspend or dispose it.
+   *
+   * @returns false if the translation unit is not in use.
+   */
+  TranslationUnitCache_release: (cache: TranslationUnitCache, TU: CXTranslationUnit) => boolean;
+
+  /**
+   * Create a store of unsaved files which stay resident in the WebAssembly
+   * heap. A store can be passed wherever an array of {@link CXUnsavedFile}
+   * is accepted; its buffers are then handed to libclang without copying.
+   *
+   * The store must be released with
+   * {@link LibClang.disposeUnsavedFileStore | disposeUnsavedFileStore()}.
+   */
+  createUnsavedFileStore: () => UnsavedFileStore;
+
+  /**
+   * Destroy the given unsaved file store.
+   */
+  disposeUnsavedFileStore: (store: UnsavedFileStore) => void;
+
+  /**
+   * Set the full contents of an unsaved file, adding it to the store if
+   * necessary.
+   */
+  UnsavedFileStore_setContents: (store: UnsavedFileStore, filename: string, contents: string | Uint8Array | ArrayBuffer) => void;
+
+  /**
+   * Replace a range of an unsaved file in place.
+   *
+   * @param offset The byte offset into the UTF-8 encoded contents at which the
+   * edit starts.
+   *
+   * @param deleteLength The number of bytes to remove at \p offset.
+   *
+   * @param insertText The text inserted at \p offset.
+   *
+   * @returns false if the file is not in the store or the range lies outside
+   * of its contents, in which case nothing is changed.
+   */
+  UnsavedFileStore_applyEdit: (store: UnsavedFileStore, filename: string, offset: number, deleteLength: number, insertText: string) => boolean;
+
+  /**
+   * Remove an unsaved file from the store.
+   *
+   * @returns false if the file was not in the store.
+   */
+  UnsavedFileStore_remove: (store: UnsavedFileStore, filename: string) => boolean;
+
+  /**
+   * Retrieve the current contents of an unsaved file, or null if the file is
+   * not in the store.
    */
-  reparseTranslationUnit: (TU: CXTranslationUnit, unsaved_files: CXUnsavedFile[] | null, options: number) => number;
+  UnsavedFileStore_getContents: (store: UnsavedFileStore, filename: string) => string | null;
 
   /**
    * Returns the human-readable null-terminated C string that represents
@@ -629,10 +903,25 @@ export type LibClang = EmscriptenModule & {
    */
   getTUResourceUsageName: (kind: EnumValue<CXTUResourceUsageKind>) => string | null;
 
-  // skipped CXTUResourceUsageEntry
-  // skipped CXTUResourceUsage
-  // skipped getCXTUResourceUsage
-  // skipped disposeCXTUResourceUsage
+  /**
+   * Return the amount of memory used by a translation unit, per category.
+   * Nothing is reported while a
+   * {@link LibClang.reparseTranslationUnitAsync | reparseTranslationUnitAsync()}
+   * of the translation unit is pending.
+   */
+  getTUResourceUsage: (TU: CXTranslationUnit) => TUResourceUsage;
+
+  /**
+   * Return the amount of memory used by all translation units of an index
+   * which were created through libclangjs and not yet disposed, summed up
+   * per category.
+   *
+   * Translation units with a pending
+   * {@link LibClang.reparseTranslationUnitAsync | reparseTranslationUnitAsync()}
+   * are skipped, as they are in use on another thread.
+   */
+  getIndexResourceUsage: (CIdx: CXIndex) => IndexResourceUsage;
+
   // skipped getTranslationUnitTargetInfo
   // skipped TargetInfo_dispose
   // skipped TargetInfo_getTriple
@@ -1555,6 +1844,64 @@ export type LibClang = EmscriptenModule & {
 
   // skipped visitChildrenWithBlock
 
+  /**
+   * Visit the descendants of a cursor that match a filter.
+   *
+   * The subtree is walked natively and \p visitor is only invoked for cursors
+   * that pass \p filter. Subtrees outside the main file or inside system
+   * headers (if requested) and below the maximum depth are skipped without
+   * calling back into JavaScript. Cursors whose kind does not match are
+   * recursed into, since their children may match.
+   *
+   * The visitor's return value steers the traversal as in
+   * {@link LibClang.visitChildren | visitChildren()}: `Recurse` descends into the
+   * matching cursor, `Continue` skips its children and `Break` ends the
+   * traversal.
+   *
+   * @returns a non-zero value if the traversal was terminated
+   * prematurely by the visitor returning \c CXChildVisit_Break.
+   */
+  visitChildrenFiltered: (parent: CXCursor, filter: CursorFilter | null, visitor: CXCursorVisitor) => number;
+
+  /**
+   * Visit the descendants of a cursor in batches.
+   *
+   * Instead of calling back into JavaScript once per cursor, children are
+   * collected natively and handed to \p visitor up to \p batchSize at a time.
+   * The per-cursor results steer the traversal as in
+   * {@link LibClang.visitChildren | visitChildren()}: the children of cursors
+   * that returned `Recurse` are delivered in later batches, `Continue` skips
+   * a cursor's children and `Break` ends the traversal, dropping the rest of
+   * the batch.
+   *
+   * Siblings are always delivered in order and parents before their
+   * children, but since decisions are made a batch at a time, cursors from
+   * different subtrees may be interleaved compared to
+   * {@link LibClang.visitChildren | visitChildren()}.
+   *
+   * @param batchSize the maximum number of cursors per batch. Defaults to 1024.
+   *
+   * @returns a non-zero value if the traversal was terminated
+   * prematurely by the visitor returning \c CXChildVisit_Break.
+   */
+  visitChildrenBatched: (parent: CXCursor, visitor: CXCursorBatchVisitor, batchSize?: number | null) => number;
+
+  /**
+   * Flatten the subtree below a cursor into typed arrays.
+   *
+   * The subtree is walked natively, in the same pre-order as a
+   * {@link LibClang.visitChildren | visitChildren()} visitor that always returns
+   * `Recurse`, so reading the whole tree costs a single call instead of one
+   * callback per cursor.
+   *
+   * @param parent the cursor whose descendants are exported. The cursor itself
+   * is not part of the result.
+   *
+   * @param fieldMask a bitwise OR of {@link CursorTreeField} values selecting
+   * the columns to produce.
+   */
+  exportCursorTree: (parent: CXCursor, fieldMask: number) => CursorTree;
+
   /**
    * Retrieve a Unified Symbol Resolution (USR) for the entity referenced
    * by the given cursor.
@@ -2061,6 +2408,23 @@ export type LibClang = EmscriptenModule & {
   // skipped annotateTokens
   // skipped disposeTokens
 
+  /**
+   * Tokenize the source code described by the given range, and optionally
+   * annotate each token with the cursor it refers to, in a single call.
+   *
+   * The tokens are disposed of before this function returns, so nothing
+   * needs to be released by the caller.
+   *
+   * @param TU The translation unit whose text is being tokenized.
+   *
+   * @param Range The source range in which text should be tokenized. All of the
+   * tokens produced by tokenization will fall within this source range.
+   *
+   * @param annotate Whether to compute the kind of the cursor of each token,
+   * as {@link LibClang.annotateTokens | annotateTokens()} would.
+   */
+  tokenizeRange: (TU: CXTranslationUnit, Range: CXSourceRange, annotate: boolean) => TokenList;
+
   /**
    * For debug / testing
    */
@@ -2090,10 +2454,89 @@ export type LibClang = EmscriptenModule & {
   // skipped CXCodeCompleteResults
   // skipped getCompletionNumFixIts
   // skipped getCompletionFixIt
-  // skipped CXCodeComplete_Flags
   // skipped CXCompletionContext
-  // skipped defaultCodeCompleteOptions
-  // skipped codeCompleteAt
+
+  /**
+   * Returns a default set of code-completion options that can be
+   * passed to {@link LibClang.codeCompleteAt | codeCompleteAt()}.
+   */
+  defaultCodeCompleteOptions: () => number;
+
+  /**
+   * Perform code completion at a given location in a translation unit and
+   * return the best matches for the text typed so far.
+   *
+   * Filtering and ranking happen natively, so only the returned completions
+   * are marshalled, no matter how many results libclang produces.
+   *
+   * @param TU The translation unit in which code-completion should
+   * occur. The source files for this translation unit need not be
+   * completely up-to-date (and the contents of those source files may
+   * be overridden via \p unsaved_files).
+   *
+   * @param complete_filename The name of the source file where code
+   * completion should be performed.
+   *
+   * @param complete_line The line at which code-completion should occur.
+   *
+   * @param complete_column The column at which code-completion should occur.
+   * Note that the column should point just after the syntactic construct that
+   * initiated code completion, and not in the middle of a lexical token.
+   *
+   * @param unsaved_files The files that have not yet been saved to disk
+   * but may be required for parsing or code completion.
+   *
+   * @param options Extra options that control the behavior of code
+   * completion, expressed as a bitwise OR of the enumerators of the
+   * {@link CXCodeComplete_Flags} enumeration.
+   *
+   * @param prefix Only completions whose typed text starts with this prefix,
+   * ignoring case, are returned.
+   *
+   * @param limit The maximum number of completions to return. The completions
+   * with the best (lowest) priority are kept, alphabetically among equals.
+   */
+  codeCompleteAt: (TU: CXTranslationUnit, complete_filename: string, complete_line: number, complete_column: number, unsaved_files: CXUnsavedFile[] | UnsavedFileStore | null, options: number, prefix: string, limit: number) => CompletionList;
+
+  /**
+   * Perform code completion once and keep the results, so that they can be
+   * re-filtered as the identifier at the completion point is typed, without
+   * running semantic analysis again.
+   *
+   * Parse the translation unit with `CXTranslationUnit_Flags.CacheCompletionResults`
+   * to speed up the initial completion.
+   *
+   * @param complete_line The line at which code-completion should occur.
+   *
+   * @param complete_column The column at which code-completion should occur,
+   * which is where the identifier being typed starts.
+   *
+   * The other parameters are the same as for {@link LibClang.codeCompleteAt | codeCompleteAt()}.
+   * The session must be released with {@link LibClang.disposeCodeCompletionSession | disposeCodeCompletionSession()}.
+   */
+  createCodeCompletionSession: (TU: CXTranslationUnit, complete_filename: string, complete_line: number, complete_column: number, unsaved_files: CXUnsavedFile[] | UnsavedFileStore | null, options: number) => CodeCompletionSession;
+
+  /**
+   * Destroy the given code completion session.
+   */
+  disposeCodeCompletionSession: (session: CodeCompletionSession) => void;
+
+  /**
+   * Filter and rank the completions of a session for the text typed so far,
+   * like {@link LibClang.codeCompleteAt | codeCompleteAt()} does.
+   *
+   * @param line The line of the cursor.
+   *
+   * @param column The column of the cursor.
+   *
+   * @param prefix The text typed since the completion point.
+   *
+   * @returns null once the cursor has left the identifier starting at the
+   * completion point, i.e. when it moved to a different line or column than
+   * the end of \p prefix, or \p prefix is not an identifier. A new session
+   * is needed then.
+   */
+  CodeCompletionSession_filter: (session: CodeCompletionSession, line: number, column: number, prefix: string, limit: number) => CompletionList | null;
   // skipped sortCodeCompletionResults
   // skipped disposeCodeCompleteResults
   // skipped codeCompleteGetNumDiagnostics
@@ -2139,20 +2582,228 @@ export type LibClang = EmscriptenModule & {
   // skipped index_setClientContainer
   // skipped index_getClientEntity
   // skipped index_setClientEntity
-  // skipped IndexAction_create
-  // skipped IndexAction_dispose
-  // skipped CXIndexOptFlags
-  // skipped indexSourceFile
+
+  /**
+   * An indexing action/session, to be applied to one or multiple
+   * translation units.
+   *
+   * @param CIdx The index object with which the index action will be associated.
+   */
+  IndexAction_create: (CIdx: CXIndex) => CXIndexAction;
+
+  /**
+   * Destroy the given index action.
+   *
+   * The index action must not be destroyed until all of the translation units
+   * created within that index action have been destroyed.
+   */
+  IndexAction_dispose: (action: CXIndexAction) => void;
+
+  /**
+   * Index the given source file and the translation unit corresponding
+   * to that file.
+   *
+   * Declarations and entity references are recorded natively while indexing
+   * and passed to \p callback in batches after indexing has finished, instead
+   * of calling into JavaScript once per event.
+   *
+   * @param callback Receives the recorded events, at most \p batchSize at a
+   * time.
+   *
+   * @param index_options A bitmask of options, a bitwise OR of {@link CXIndexOptFlags}.
+   *
+   * @param TU_options A bitmask of options, a bitwise OR of {@link CXTranslationUnit_Flags}.
+   *
+   * The remaining parameters are the same as for {@link LibClang.parseTranslationUnit | parseTranslationUnit()}.
+   *
+   * @param batchSize The maximum number of events per batch. Defaults to 1024.
+   *
+   * @returns 0 on success or if there were errors from which the compiler could
+   * recover. If there is a failure from which there is no recovery, returns
+   * a non-zero {@link CXErrorCode}.
+   */
+  indexSourceFile: (action: CXIndexAction, callback: (events: IndexEvents) => void, index_options: number, source_filename: string | null, command_line_args: string[] | null, unsaved_files: CXUnsavedFile[] | UnsavedFileStore | null, TU_options: number, batchSize?: number | null) => number;
+
   // skipped indexSourceFileFullArgv
-  // skipped indexTranslationUnit
+
+  /**
+   * Index the given translation unit via callbacks implemented through
+   * {@link IndexEvents}, like {@link LibClang.indexSourceFile | indexSourceFile()}.
+   *
+   * The order of callback invocations is not guaranteed to be the same as
+   * when indexing a source file. The high level order will be:
+   *
+   *   -Preprocessor callbacks invocations
+   *   -Declaration/reference callbacks invocations
+   *   -Diagnostic callback invocations
+   *
+   * @returns If there is a failure from which there is no recovery, returns
+   * non-zero, otherwise returns 0.
+   */
+  indexTranslationUnit: (action: CXIndexAction, callback: (events: IndexEvents) => void, index_options: number, TU: CXTranslationUnit, batchSize?: number | null) => number;
+
+  /**
+   * Create an empty symbol index.
+   *
+   * The index must be released with {@link LibClang.disposeSymbolIndex | disposeSymbolIndex()}.
+   */
+  createSymbolIndex: () => SymbolIndex;
+
+  /**
+   * Destroy the given symbol index.
+   */
+  disposeSymbolIndex: (symbolIndex: SymbolIndex) => void;
+
+  /**
+   * Index a translation unit and replace the locations of all files it
+   * consists of.
+   *
+   * @returns 0 on success, in which case the symbol index was updated, or
+   * non-zero otherwise.
+   */
+  SymbolIndex_updateFromTranslationUnit: (symbolIndex: SymbolIndex, action: CXIndexAction, TU: CXTranslationUnit) => number;
+
+  /**
+   * Remove all locations within a file.
+   *
+   * @returns false if there were no locations within the file.
+   */
+  SymbolIndex_removeFile: (symbolIndex: SymbolIndex, filename: string) => boolean;
+
+  /**
+   * Find the locations of the entity with the given USR.
+   */
+  SymbolIndex_lookup: (symbolIndex: SymbolIndex, usr: string) => SymbolLocations;
+
+  /**
+   * Find the locations of all entities whose USR starts with \p prefix.
+   */
+  SymbolIndex_lookupPrefix: (symbolIndex: SymbolIndex, prefix: string) => SymbolLocations;
+
+  /**
+   * Write the symbol index to a file, in a compact binary format made of a
+   * sorted string table and fixed-width records.
+   *
+   * @returns false if the file could not be written.
+   */
+  SymbolIndex_save: (symbolIndex: SymbolIndex, filename: string) => boolean;
+
+  /**
+   * Replace the contents of the symbol index with those of a file written by
+   * {@link LibClang.SymbolIndex_save | SymbolIndex_save()}, which is read at once.
+   *
+   * @returns false if the file could not be read or is not a valid symbol
+   * index, in which case the symbol index is left unchanged.
+   */
+  SymbolIndex_load: (symbolIndex: SymbolIndex, filename: string) => boolean;
+
+  /**
+   * Create an indexing session for indexing many translation units of a
+   * project, which share a single {@link CXIndexAction}.
+   *
+   * Function bodies which were already parsed in the session are skipped, and
+   * events located in headers which were indexed as part of an earlier
+   * translation unit are dropped, so each header is reported only once. Events
+   * in the main file are always reported, so an edited file may be indexed
+   * again.
+   *
+   * The session must be released with {@link LibClang.disposeIndexingSession | disposeIndexingSession()}.
+   */
+  createIndexingSession: (CIdx: CXIndex) => IndexingSession;
+
+  /**
+   * Destroy the given indexing session.
+   */
+  disposeIndexingSession: (session: IndexingSession) => void;
+
+  /**
+   * Same as {@link LibClang.indexSourceFile | indexSourceFile()}, but within an
+   * indexing session. `CXIndexOptFlags.SkipParsedBodiesInSession` is always
+   * added to \p index_options.
+   */
+  IndexingSession_indexSourceFile: (session: IndexingSession, callback: (events: IndexEvents) => void, index_options: number, source_filename: string | null, command_line_args: string[] | null, unsaved_files: CXUnsavedFile[] | UnsavedFileStore | null, TU_options: number, batchSize?: number | null) => number;
+
+  /**
+   * Retrieve statistics about what an indexing session has indexed and
+   * skipped so far.
+   */
+  IndexingSession_getStats: (session: IndexingSession) => IndexingSessionStats;
+
   // skipped indexLoc_getFileLocation
   // skipped indexLoc_getCXSourceLocation
   // skipped Type_visitFields
 
   isNullPointer: (pointer: any) => boolean;
 
+  /**
+   * Return the address of a handle, e.g. a {@link CXTranslationUnit}, for use
+   * with the {@link LibClang.raw | raw} functions.
+   */
+  getPointerAddress: (pointer: any) => number;
+
+  /**
+   * Retrieve statistics about the WebAssembly heap and the allocator.
+   *
+   * The heap grows on demand and never shrinks, so a high
+   * {@link HeapStats.fragmentation | fragmentation} on a large heap hints at
+   * recycling the instance.
+   */
+  getHeapStats: () => HeapStats;
+
+  /**
+   * Return the calls recorded for each bound function since initialization
+   * or the last {@link LibClang.resetBindingProfile | resetBindingProfile()},
+   * ordered by self time, highest first.
+   *
+   * Calls are only recorded if libclangjs was initialized with
+   * `libclangjsProfiling: true`.
+   */
+  getBindingProfile: () => BindingProfileEntry[];
+
+  /**
+   * Discard the recorded profile and trace.
+   */
+  resetBindingProfile: () => void;
+
+  /**
+   * Return the recorded calls as a Chrome trace event timeline. At most one
+   * million calls are kept.
+   */
+  getBindingTrace: () => BindingTrace;
+
   FS: FS;
 
+  /**
+   * View of the WebAssembly heap. Its length is the current heap size, which
+   * only grows.
+   */
+  HEAP8: Int8Array;
+
+  /**
+   * Return the number of JavaScript values currently held by native code
+   * through embind. A number that keeps growing indicates a leak.
+   */
+  count_emval_handles: () => number;
+
+  /**
+   * Return the number of pointer handles, e.g. {@link CXIndex} or
+   * {@link CXTranslationUnit}, which were returned to JavaScript and neither
+   * deleted nor garbage collected yet, plus those in use by native code. A number that keeps growing
+   * indicates a leak.
+   */
+  countLivePointers: () => number;
+
+  /**
+   * Plain exports for cursor, type and location accessors in hot loops, see
+   * {@link RawLibClang}.
+   */
+  raw: RawLibClang;
+
+  /**
+   * Error codes returned by libclang routines.
+   */
+  CXErrorCode: CXErrorCode;
+
   CXGlobalOptFlags: CXGlobalOptFlags;
 
   /**
@@ -2164,6 +2815,11 @@ export type LibClang = EmscriptenModule & {
    */
   CXChildVisitResult: CXChildVisitResult;
 
+  /**
+   * Selects the columns produced by {@link LibClang.exportCursorTree | exportCursorTree()}.
+   */
+  CursorTreeField: CursorTreeField;
+
   /**
    * Describes the kind of entity that a cursor refers to.
    */
@@ -2320,6 +2976,12 @@ export type LibClang = EmscriptenModule & {
    */
   CXCompletionChunkKind: CXCompletionChunkKind;
 
+  /**
+   * Flags that can be passed to {@link LibClang.codeCompleteAt | codeCompleteAt()} to
+   * modify its behavior.
+   */
+  CXCodeComplete_Flags: CXCodeComplete_Flags;
+
   CXVisitorResult: CXVisitorResult;
 
   CXResult: CXResult;
@@ -2351,4 +3013,11 @@ export type LibClang = EmscriptenModule & {
    * higher bits zeroed. These high bits may be exposed in the future.
    */
   CXSymbolRole: CXSymbolRole;
+
+  CXIndexOptFlags: CXIndexOptFlags;
+
+  /**
+   * The kinds of events in {@link IndexEvents}.
+   */
+  IndexEventKind: IndexEventKind;
 };
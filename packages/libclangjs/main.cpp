@@ -1,59 +1,2484 @@
 #include <algorithm>
+#include <atomic>
 #include <clang-c/Index.h>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <ctype.h>
+#include <deque>
 #include <emscripten.h>
 #include <emscripten/bind.h>
+#include <emscripten/heap.h>
+#include <emscripten/threading.h>
 #include <emscripten/val.h>
+#include <fstream>
 #include <iostream>
+#include <list>
+#include <malloc.h>
+#include <map>
+#include <mutex>
 #include <string.h>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 using namespace std;
 
+// The number of Pointer objects alive. Embind allocates a copy for each
+// Pointer returned to JS, which lives until its handle is deleted, so a
+// number that keeps growing indicates leaked handles.
+std::atomic<size_t> livePointers{0};
+
 struct Pointer {
   void *ptr;
+
+  Pointer(void *ptr = nullptr) : ptr(ptr) { livePointers++; }
+  Pointer(const Pointer &other) : ptr(other.ptr) { livePointers++; }
+  Pointer &operator=(const Pointer &) = default;
+  ~Pointer() { livePointers--; }
+};
+
+// Binding type of CXCursor, CXType, CXSourceLocation and CXSourceRange, which
+// consist of 32 bit fields only. Their JS side, see registerStructType, copies
+// the fields between the heap and plain objects directly. Values pass through
+// rings of slots rather than allocated copies: a call takes or returns fewer
+// structs than a ring has slots, and each is copied out of its slot before
+// the ring comes around again. Only the main thread converts values.
+constexpr unsigned structSlotCount = 16;
+
+template <typename T> struct StructBindingType {
+  typedef const T *WireType;
+
+  // Written by the JS side for arguments.
+  static T argumentSlots[structSlotCount];
+
+  static WireType toWireType(const T &value) {
+    static T resultSlots[structSlotCount];
+    static unsigned next = 0;
+    T *slot = &resultSlots[next];
+    next = (next + 1) % structSlotCount;
+    *slot = value;
+    return slot;
+  }
+  static T fromWireType(WireType value) { return *value; }
+};
+
+template <typename T>
+T StructBindingType<T>::argumentSlots[structSlotCount];
+
+namespace emscripten {
+namespace internal {
+template <>
+struct BindingType<CXCursor> : StructBindingType<CXCursor> {};
+template <> struct BindingType<CXType> : StructBindingType<CXType> {};
+template <>
+struct BindingType<CXSourceLocation> : StructBindingType<CXSourceLocation> {};
+template <>
+struct BindingType<CXSourceRange> : StructBindingType<CXSourceRange> {};
+} // namespace internal
+} // namespace emscripten
+
+// Registers the JS side of StructBindingType<T>. Values are objects with the
+// given comma separated fields, which share a no-op delete(), so that code
+// written for the former class handles keeps working. The first field holds a
+// value of the enum named enumName unless that is empty, and fields whose bit
+// is set in signedFields are signed. registerType and
+// simpleReadValueFromPointer are part of embind.
+EM_JS(void, registerStructType,
+      (emscripten::internal::TYPEID rawType, const char *name,
+       const char *fieldNames, const char *enumName, unsigned signedFields,
+       void *argumentSlots, unsigned slotCount),
+      {
+        var fields = UTF8ToString(fieldNames).split(",");
+        var enumTypeName = UTF8ToString(enumName);
+        var enumValues = null;
+        var next = 0;
+        function Struct() {}
+        Struct.prototype["delete"] = function() {};
+        registerType(rawType, {
+          name: UTF8ToString(name),
+          "fromWireType": function(ptr) {
+            var value = new Struct();
+            var i = ptr >> 2;
+            for (var j = 0; j < fields.length; j++) {
+              value[fields[j]] =
+                  signedFields & (1 << j) ? HEAP32[i + j] : HEAPU32[i + j];
+            }
+            if (enumTypeName) {
+              enumValues = enumValues || Module[enumTypeName].values;
+              value[fields[0]] = enumValues[value[fields[0]]];
+            }
+            return value;
+          },
+          "toWireType": function(destructors, value) {
+            if (value === null || typeof value !== "object") {
+              throwBindingError("Cannot pass " + value + " as " + this.name);
+            }
+            var ptr = argumentSlots + next * fields.length * 4;
+            next = (next + 1) % slotCount;
+            var i = ptr >> 2;
+            for (var j = 0; j < fields.length; j++) {
+              var field = value[fields[j]];
+              if (j == 0 && enumTypeName && typeof field === "object") {
+                field = field.value;
+              }
+              HEAPU32[i + j] = field;
+            }
+            return ptr;
+          },
+          "argPackAdvance": 8,
+          "readValueFromPointer": simpleReadValueFromPointer,
+          destructorFunction: null,
+        });
+      });
+
+template <typename T>
+void registerStruct(const char *name, const char *fieldNames,
+                    const char *enumName = "", unsigned signedFields = 0) {
+  registerStructType(emscripten::internal::TypeID<T>::get(), name, fieldNames,
+                     enumName, signedFields,
+                     StructBindingType<T>::argumentSlots, structSlotCount);
+}
+
+// Bump allocator owning the memory marshalled for the duration of a single
+// call. Nothing is freed individually; all chunks are released at once when the
+// arena goes out of scope.
+class Arena {
+public:
+  Arena() = default;
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+  ~Arena() {
+    for (char *chunk : chunks) {
+      free(chunk);
+    }
+  }
+
+  void *allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+    if (size > ChunkSize / 4) {
+      // Large blocks, like file contents, get a chunk of their own so they do
+      // not waste the remainder of the current one.
+      return newChunk(size);
+    }
+    size_t offset = (used + alignment - 1) & ~(alignment - 1);
+    if (current == nullptr || offset + size > ChunkSize) {
+      current = newChunk(ChunkSize);
+      offset = 0;
+    }
+    used = offset + size;
+    return current + offset;
+  }
+
+  template <typename T> T *allocateArray(size_t length) {
+    return static_cast<T *>(allocate(sizeof(T) * length, alignof(T)));
+  }
+
+  const char *copyString(const std::string &str) {
+    char *ret = static_cast<char *>(allocate(str.size() + 1, 1));
+    memcpy(ret, str.c_str(), str.size() + 1);
+    return ret;
+  }
+
+  // Takes ownership of an already converted string instead of copying it.
+  const char *adoptString(std::string &&str) {
+    adopted.push_back(std::move(str));
+    return adopted.back().c_str();
+  }
+
+private:
+  static constexpr size_t ChunkSize = 16 * 1024;
+
+  char *newChunk(size_t size) {
+    chunks.push_back(static_cast<char *>(malloc(size)));
+    return chunks.back();
+  }
+
+  std::vector<char *> chunks;
+  std::deque<std::string> adopted;
+  char *current = nullptr;
+  size_t used = 0;
+};
+
+struct ConvertJSStringArrayResult {
+  const char *const *stringArray;
+  size_t length;
+};
+
+ConvertJSStringArrayResult convertJSStringArray(emscripten::val v,
+                                                Arena &arena) {
+  if (v.isNull() || v.isUndefined()) {
+    return {nullptr, 0};
+  }
+  std::vector<std::string> vs = emscripten::vecFromJSArray<std::string>(v);
+  const char **ret = arena.allocateArray<const char *>(vs.size());
+  for (size_t i = 0; i < vs.size(); i++) {
+    ret[i] = arena.copyString(vs[i]);
+  }
+  return {ret, vs.size()};
+}
+
+struct ConvertUnsavedFilesResult {
+  CXUnsavedFile *unsavedFiles;
+  unsigned length;
+};
+
+// Accepts a string, a Uint8Array or an ArrayBuffer. Binary contents are copied
+// straight into the heap, strings are UTF-8 encoded exactly once.
+std::string convertUnsavedFileContents(emscripten::val contents) {
+  emscripten::val Uint8Array = emscripten::val::global("Uint8Array");
+  emscripten::val ArrayBuffer = emscripten::val::global("ArrayBuffer");
+  if (contents.instanceof(ArrayBuffer)) {
+    contents = Uint8Array.new_(contents);
+  }
+  if (contents.instanceof(Uint8Array)) {
+    std::string ret(contents["length"].as<size_t>(), '\0');
+    emscripten::val(emscripten::typed_memory_view(ret.size(), ret.data()))
+        .call<void>("set", contents);
+    return ret;
+  }
+  return contents.as<std::string>();
+}
+
+// Unsaved files which stay resident in the heap between calls, so that only
+// edits need to be marshalled.
+struct UnsavedFileStore {
+  std::map<std::string, std::string> files;
+
+  // With copy set, the arena receives a snapshot of the contents, so that the
+  // store may be edited while the result is still in use by another thread.
+  ConvertUnsavedFilesResult toUnsavedFiles(Arena &arena, bool copy) const {
+    if (files.empty()) {
+      return {nullptr, 0};
+    }
+    CXUnsavedFile *ret = arena.allocateArray<CXUnsavedFile>(files.size());
+    unsigned i = 0;
+    for (const auto &[filename, contents] : files) {
+      ret[i++] = {copy ? arena.copyString(filename) : filename.c_str(),
+                  copy ? arena.adoptString(std::string(contents))
+                       : contents.data(),
+                  contents.size()};
+    }
+    return {ret, i};
+  }
+};
+
+// Handle of an UnsavedFileStore, bound as a class of its own so that other
+// pointers are not mistaken for a store.
+struct UnsavedFileStoreHandle {
+  UnsavedFileStore *ptr;
+};
+
+// Accepts an array of CXUnsavedFile or an UnsavedFileStore, whose buffers are
+// passed on without copying unless a snapshot is requested.
+ConvertUnsavedFilesResult convertUnsavedFiles(emscripten::val f, Arena &arena,
+                                              bool snapshotStore = false) {
+  if (f.isNull() || f.isUndefined()) {
+    return {nullptr, 0};
+  }
+  if (f.instanceof(emscripten::val::module_property("UnsavedFileStore"))) {
+    return f.as<UnsavedFileStoreHandle>().ptr->toUnsavedFiles(arena,
+                                                              snapshotStore);
+  }
+  std::vector<emscripten::val> vuf =
+      emscripten::vecFromJSArray<emscripten::val>(f);
+  if (vuf.empty()) {
+    return {nullptr, 0};
+  }
+  CXUnsavedFile *ret = arena.allocateArray<CXUnsavedFile>(vuf.size());
+  for (size_t i = 0; i < vuf.size(); i++) {
+    std::string contents = convertUnsavedFileContents(vuf[i]["contents"]);
+    unsigned long length = contents.size();
+    ret[i] = {arena.copyString(vuf[i]["filename"].as<std::string>()),
+              arena.adoptString(std::move(contents)), length};
+  }
+  return {ret, static_cast<unsigned>(vuf.size())};
+}
+
+std::string cxStringToStdString(CXString str) {
+  std::string result = clang_getCString(str);
+  clang_disposeString(str);
+  return result;
+}
+
+emscripten::val cxStringToStdStringOrNull(CXString str) {
+  if (clang_getCString(str) == nullptr) {
+    return emscripten::val::null();
+  } else {
+    return emscripten::val(cxStringToStdString(str));
+  }
+}
+
+template <typename T>
+emscripten::val vectorToTypedArray(const std::vector<T> &v) {
+  // slice() copies the view out of the wasm heap, so the result stays valid
+  // after the vector is released or the memory grows.
+  return emscripten::val(emscripten::typed_memory_view(v.size(), v.data()))
+      .call<emscripten::val>("slice");
+}
+
+struct StringTable {
+  std::vector<std::string> strings;
+  std::unordered_map<std::string, uint32_t> indices;
+
+  uint32_t intern(const std::string &str) {
+    auto [it, inserted] = indices.emplace(str, strings.size());
+    if (inserted) {
+      strings.push_back(str);
+    }
+    return it->second;
+  }
+
+  emscripten::val toJSArray() const {
+    if (strings.empty()) {
+      return emscripten::val::array();
+    }
+    // Marshal the whole table as a single string and split it on the JS side,
+    // instead of crossing the boundary once per entry.
+    std::string joined;
+    for (size_t i = 0; i < strings.size(); i++) {
+      if (i > 0) {
+        joined.push_back('\0');
+      }
+      joined.append(strings[i]);
+    }
+    return emscripten::val(joined).call<emscripten::val>("split",
+                                                         std::string(1, '\0'));
+  }
+};
+
+// Interns the names of files, caching the lookup per CXFile. A null file maps
+// to the empty string.
+struct FileTable {
+  StringTable names;
+  std::unordered_map<CXFile, uint32_t> indices;
+
+  uint32_t intern(CXFile file) {
+    auto it = indices.find(file);
+    if (it == indices.end()) {
+      std::string name =
+          file == nullptr ? "" : cxStringToStdString(clang_getFileName(file));
+      it = indices.emplace(file, names.intern(name)).first;
+    }
+    return it->second;
+  }
+};
+
+template <typename Visitor> struct CursorTreeWalk {
+  Visitor &visitor;
+  std::vector<CXCursor> ancestors;
 };
 
-struct ConvertJSStringArrayResult {
-  const char *const *stringArray;
-  size_t length;
+// Pre-order walk over the descendants of root. The visitor receives each
+// cursor, its parent and its depth (1 for direct children of root) and steers
+// the walk like a regular CXCursorVisitor. Ancestors are tracked on an explicit
+// stack, so deep trees do not recurse on the (small) wasm stack.
+template <typename Visitor>
+void walkCursorTree(CXCursor root, Visitor &&visitor) {
+  CursorTreeWalk<Visitor> walk{visitor, {root}};
+  clang_visitChildren(
+      root,
+      [](CXCursor cursor, CXCursor parent, CXClientData client_data) {
+        auto *walk = static_cast<CursorTreeWalk<Visitor> *>(client_data);
+        while (walk->ancestors.size() > 1 &&
+               !clang_equalCursors(walk->ancestors.back(), parent)) {
+          walk->ancestors.pop_back();
+        }
+        unsigned depth = walk->ancestors.size();
+        CXChildVisitResult result = walk->visitor(cursor, parent, depth);
+        if (result == CXChildVisit_Recurse) {
+          walk->ancestors.push_back(cursor);
+        }
+        return result;
+      },
+      &walk);
+}
+
+struct CursorFilter {
+  // Indexed by CXCursorKind; empty when every kind matches.
+  std::vector<bool> kinds;
+  bool mainFileOnly = false;
+  bool excludeSystemHeaders = false;
+  // 0 means unlimited.
+  unsigned maxDepth = 0;
+
+  bool matchesKind(CXCursorKind kind) const {
+    return kinds.empty() || (static_cast<size_t>(kind) < kinds.size() &&
+                             kinds[static_cast<size_t>(kind)]);
+  }
+
+  // Location filters apply to whole subtrees: the children of a cursor that
+  // is outside the main file (or inside a system header) are as well.
+  bool prunesSubtree(CXCursor cursor) const {
+    if (!mainFileOnly && !excludeSystemHeaders) {
+      return false;
+    }
+    CXSourceLocation location = clang_getCursorLocation(cursor);
+    return (mainFileOnly && !clang_Location_isFromMainFile(location)) ||
+           (excludeSystemHeaders && clang_Location_isInSystemHeader(location));
+  }
+};
+
+CursorFilter convertCursorFilter(emscripten::val filter) {
+  CursorFilter ret;
+  if (filter.isNull() || filter.isUndefined()) {
+    return ret;
+  }
+  emscripten::val kinds = filter["kinds"];
+  if (!(kinds.isNull() || kinds.isUndefined())) {
+    ret.kinds.resize(CXCursor_OverloadCandidate + 1);
+    for (auto &kind : emscripten::vecFromJSArray<emscripten::val>(kinds)) {
+      int value = kind["value"].as<int>();
+      if (value >= 0 && static_cast<size_t>(value) < ret.kinds.size()) {
+        ret.kinds[value] = true;
+      }
+    }
+  }
+  ret.mainFileOnly = filter["mainFileOnly"].isTrue();
+  ret.excludeSystemHeaders = filter["excludeSystemHeaders"].isTrue();
+  emscripten::val maxDepth = filter["maxDepth"];
+  if (!(maxDepth.isNull() || maxDepth.isUndefined())) {
+    ret.maxDepth = maxDepth.as<unsigned>();
+  }
+  return ret;
+}
+
+struct CursorBatch {
+  std::vector<CXCursor> cursors;
+  std::vector<CXCursor> parents;
+};
+
+// Breadth-first over each expanded cursor, depth-first across batches: the
+// children of every cursor the visitor chose to recurse into are collected
+// natively and handed to JS batchSize pairs at a time.
+unsigned visitChildrenBatched(CXCursor root, emscripten::val visitor,
+                              size_t batchSize) {
+  std::vector<CXCursor> toExpand = {root};
+  CursorBatch batch;
+  while (!toExpand.empty()) {
+    while (!toExpand.empty() && batch.cursors.size() < batchSize) {
+      CXCursor parent = toExpand.back();
+      toExpand.pop_back();
+      clang_visitChildren(
+          parent,
+          [](CXCursor cursor, CXCursor parent, CXClientData client_data) {
+            auto *batch = static_cast<CursorBatch *>(client_data);
+            batch->cursors.push_back(cursor);
+            batch->parents.push_back(parent);
+            return CXChildVisit_Continue;
+          },
+          &batch);
+    }
+    std::vector<CXCursor> recursed;
+    for (size_t begin = 0; begin < batch.cursors.size(); begin += batchSize) {
+      size_t end = std::min(begin + batchSize, batch.cursors.size());
+      emscripten::val cursors = emscripten::val::array();
+      emscripten::val parents = emscripten::val::array();
+      for (size_t i = begin; i < end; i++) {
+        cursors.set(i - begin, batch.cursors[i]);
+        parents.set(i - begin, batch.parents[i]);
+      }
+      emscripten::val result = visitor(cursors, parents);
+      std::vector<int> decisions =
+          (result.isNull() || result.isUndefined())
+              ? std::vector<int>()
+              : emscripten::convertJSArrayToNumberVector<int>(result);
+      for (size_t i = begin; i < end; i++) {
+        // A missing decision means the visitor wants to recurse.
+        CXChildVisitResult decision =
+            i - begin < decisions.size()
+                ? static_cast<CXChildVisitResult>(decisions[i - begin])
+                : CXChildVisit_Recurse;
+        if (decision == CXChildVisit_Break) {
+          return 1;
+        }
+        if (decision == CXChildVisit_Recurse) {
+          recursed.push_back(batch.cursors[i]);
+        }
+      }
+    }
+    batch.cursors.clear();
+    batch.parents.clear();
+    toExpand.insert(toExpand.end(), recursed.rbegin(), recursed.rend());
+  }
+  return 0;
+}
+
+enum CursorTreeField {
+  CursorTreeField_Kind = 0x1,
+  CursorTreeField_Parent = 0x2,
+  CursorTreeField_Depth = 0x4,
+  CursorTreeField_File = 0x8,
+  CursorTreeField_Offsets = 0x10,
+  CursorTreeField_Spelling = 0x20,
+  CursorTreeField_All = 0x3f
+};
+
+emscripten::val exportCursorTree(CXCursor root, unsigned fieldMask) {
+  std::vector<uint16_t> kinds;
+  std::vector<int32_t> parents;
+  std::vector<uint32_t> depths;
+  std::vector<uint32_t> fileIds;
+  std::vector<uint32_t> startOffsets;
+  std::vector<uint32_t> endOffsets;
+  std::vector<uint32_t> spellings;
+  FileTable files;
+  StringTable strings;
+  // Index of the most recently emitted cursor at each depth; the entry at
+  // depth - 1 is the parent of the cursor being visited.
+  std::vector<int32_t> lastAtDepth;
+  int32_t count = 0;
+
+  walkCursorTree(root, [&](CXCursor cursor, CXCursor, unsigned depth) {
+    if (fieldMask & CursorTreeField_Kind) {
+      kinds.push_back(clang_getCursorKind(cursor));
+    }
+    if (fieldMask & CursorTreeField_Parent) {
+      parents.push_back(depth > 1 ? lastAtDepth[depth - 2] : -1);
+    }
+    if (fieldMask & CursorTreeField_Depth) {
+      depths.push_back(depth);
+    }
+    if (fieldMask & (CursorTreeField_File | CursorTreeField_Offsets)) {
+      CXSourceRange extent = clang_getCursorExtent(cursor);
+      CXFile file = nullptr;
+      unsigned start = 0, end = 0;
+      clang_getFileLocation(clang_getRangeStart(extent), &file, nullptr,
+                            nullptr, &start);
+      clang_getFileLocation(clang_getRangeEnd(extent), nullptr, nullptr,
+                            nullptr, &end);
+      if (fieldMask & CursorTreeField_File) {
+        fileIds.push_back(files.intern(file));
+      }
+      if (fieldMask & CursorTreeField_Offsets) {
+        startOffsets.push_back(start);
+        endOffsets.push_back(end);
+      }
+    }
+    if (fieldMask & CursorTreeField_Spelling) {
+      spellings.push_back(
+          strings.intern(cxStringToStdString(clang_getCursorSpelling(cursor))));
+    }
+    lastAtDepth.resize(depth - 1);
+    lastAtDepth.push_back(count++);
+    return CXChildVisit_Recurse;
+  });
+
+  emscripten::val ret = emscripten::val::object();
+  ret.set("length", count);
+  if (fieldMask & CursorTreeField_Kind) {
+    ret.set("kind", vectorToTypedArray(kinds));
+  }
+  if (fieldMask & CursorTreeField_Parent) {
+    ret.set("parent", vectorToTypedArray(parents));
+  }
+  if (fieldMask & CursorTreeField_Depth) {
+    ret.set("depth", vectorToTypedArray(depths));
+  }
+  if (fieldMask & CursorTreeField_File) {
+    ret.set("file", vectorToTypedArray(fileIds));
+    ret.set("files", files.names.toJSArray());
+  }
+  if (fieldMask & CursorTreeField_Offsets) {
+    ret.set("startOffset", vectorToTypedArray(startOffsets));
+    ret.set("endOffset", vectorToTypedArray(endOffsets));
+  }
+  if (fieldMask & CursorTreeField_Spelling) {
+    ret.set("spelling", vectorToTypedArray(spellings));
+    ret.set("strings", strings.toJSArray());
+  }
+  return ret;
+}
+
+// Tokenizes a range into parallel typed arrays and disposes of the tokens.
+emscripten::val tokenizeRange(CXTranslationUnit tu, CXSourceRange range,
+                              bool annotate) {
+  CXToken *tokens = nullptr;
+  unsigned numTokens = 0;
+  clang_tokenize(tu, range, &tokens, &numTokens);
+  std::vector<uint8_t> kinds(numTokens);
+  std::vector<uint32_t> offsets(numTokens);
+  std::vector<uint32_t> lengths(numTokens);
+  for (unsigned i = 0; i < numTokens; i++) {
+    kinds[i] = clang_getTokenKind(tokens[i]);
+    CXSourceRange extent = clang_getTokenExtent(tu, tokens[i]);
+    unsigned start = 0;
+    unsigned end = 0;
+    clang_getFileLocation(clang_getRangeStart(extent), nullptr, nullptr,
+                          nullptr, &start);
+    clang_getFileLocation(clang_getRangeEnd(extent), nullptr, nullptr, nullptr,
+                          &end);
+    offsets[i] = start;
+    lengths[i] = end - start;
+  }
+  emscripten::val ret = emscripten::val::object();
+  ret.set("kind", vectorToTypedArray(kinds));
+  ret.set("offset", vectorToTypedArray(offsets));
+  ret.set("length", vectorToTypedArray(lengths));
+  if (annotate) {
+    std::vector<CXCursor> cursors(numTokens);
+    clang_annotateTokens(tu, tokens, numTokens, cursors.data());
+    std::vector<uint16_t> cursorKinds(numTokens);
+    for (unsigned i = 0; i < numTokens; i++) {
+      cursorKinds[i] = clang_getCursorKind(cursors[i]);
+    }
+    ret.set("cursorKind", vectorToTypedArray(cursorKinds));
+  }
+  clang_disposeTokens(tu, tokens, numTokens);
+  return ret;
+}
+
+// A completion result reduced to what is needed to filter, rank and encode it.
+// The completion string stays owned by its CXCodeCompleteResults.
+struct CompletionCandidate {
+  CXCompletionString completionString;
+  CXCursorKind cursorKind;
+  unsigned priority;
+  std::string typedText;
+};
+
+// Concatenates the text of a chunk, including nested optional chunks.
+std::string completionChunkText(CXCompletionString completionString,
+                                unsigned chunk) {
+  if (clang_getCompletionChunkKind(completionString, chunk) !=
+      CXCompletionChunk_Optional) {
+    return cxStringToStdString(
+        clang_getCompletionChunkText(completionString, chunk));
+  }
+  CXCompletionString optional =
+      clang_getCompletionChunkCompletionString(completionString, chunk);
+  std::string ret;
+  for (unsigned i = 0; i < clang_getNumCompletionChunks(optional); i++) {
+    ret += completionChunkText(optional, i);
+  }
+  return ret;
+}
+
+// Returns the candidates in the alphabetical order of
+// clang_sortCodeCompletionResults.
+std::vector<CompletionCandidate>
+collectCompletionCandidates(CXCodeCompleteResults *results) {
+  std::vector<CompletionCandidate> ret;
+  if (results == nullptr) {
+    return ret;
+  }
+  clang_sortCodeCompletionResults(results->Results, results->NumResults);
+  ret.reserve(results->NumResults);
+  for (unsigned i = 0; i < results->NumResults; i++) {
+    CXCompletionString completionString = results->Results[i].CompletionString;
+    CompletionCandidate candidate{
+        completionString, results->Results[i].CursorKind,
+        clang_getCompletionPriority(completionString), {}};
+    for (unsigned j = 0; j < clang_getNumCompletionChunks(completionString);
+         j++) {
+      if (clang_getCompletionChunkKind(completionString, j) ==
+          CXCompletionChunk_TypedText) {
+        candidate.typedText = cxStringToStdString(
+            clang_getCompletionChunkText(completionString, j));
+        break;
+      }
+    }
+    ret.push_back(std::move(candidate));
+  }
+  return ret;
+}
+
+bool startsWithIgnoringCase(const std::string &str, const std::string &prefix) {
+  if (prefix.size() > str.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < prefix.size(); i++) {
+    if (tolower(static_cast<unsigned char>(str[i])) !=
+        tolower(static_cast<unsigned char>(prefix[i]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Keeps the candidates whose typed text starts with prefix, ignoring case, and
+// returns the (at most) limit best ones by priority. Candidates of equal
+// priority keep their relative order. The number of matching candidates before
+// applying the limit is stored in matches.
+std::vector<const CompletionCandidate *>
+selectCompletions(const std::vector<CompletionCandidate> &candidates,
+                  const std::string &prefix, unsigned limit, size_t &matches) {
+  std::vector<const CompletionCandidate *> ret;
+  for (const CompletionCandidate &candidate : candidates) {
+    if (startsWithIgnoringCase(candidate.typedText, prefix)) {
+      ret.push_back(&candidate);
+    }
+  }
+  matches = ret.size();
+  size_t k = std::min<size_t>(limit, ret.size());
+  std::partial_sort(
+      ret.begin(), ret.begin() + k, ret.end(),
+      [](const CompletionCandidate *a, const CompletionCandidate *b) {
+        return a->priority != b->priority ? a->priority < b->priority : a < b;
+      });
+  ret.resize(k);
+  return ret;
+}
+
+// Encodes completions as parallel typed arrays. The chunks of completion i are
+// chunkKind[chunkOffsets[i]] to chunkKind[chunkOffsets[i + 1] - 1], their texts
+// index into strings.
+emscripten::val
+encodeCompletions(const std::vector<const CompletionCandidate *> &completions,
+                  size_t matches) {
+  std::vector<uint16_t> cursorKinds;
+  std::vector<uint32_t> priorities;
+  std::vector<uint32_t> chunkOffsets{0};
+  std::vector<uint8_t> chunkKinds;
+  std::vector<uint32_t> chunkTexts;
+  StringTable strings;
+  for (const CompletionCandidate *completion : completions) {
+    cursorKinds.push_back(completion->cursorKind);
+    priorities.push_back(completion->priority);
+    unsigned numChunks =
+        clang_getNumCompletionChunks(completion->completionString);
+    for (unsigned i = 0; i < numChunks; i++) {
+      chunkKinds.push_back(
+          clang_getCompletionChunkKind(completion->completionString, i));
+      chunkTexts.push_back(strings.intern(
+          completionChunkText(completion->completionString, i)));
+    }
+    chunkOffsets.push_back(chunkKinds.size());
+  }
+  emscripten::val ret = emscripten::val::object();
+  ret.set("length", completions.size());
+  ret.set("matches", matches);
+  ret.set("cursorKind", vectorToTypedArray(cursorKinds));
+  ret.set("priority", vectorToTypedArray(priorities));
+  ret.set("chunkOffsets", vectorToTypedArray(chunkOffsets));
+  ret.set("chunkKind", vectorToTypedArray(chunkKinds));
+  ret.set("chunkText", vectorToTypedArray(chunkTexts));
+  ret.set("strings", strings.toJSArray());
+  return ret;
+}
+
+// The results of one code completion run, which are re-filtered as the
+// identifier at the completion point is typed.
+struct CodeCompletionSession {
+  CXCodeCompleteResults *results;
+  std::vector<CompletionCandidate> candidates;
+  unsigned line;
+  unsigned column;
+
+  CodeCompletionSession(CXCodeCompleteResults *results, unsigned line,
+                        unsigned column)
+      : results(results), candidates(collectCompletionCandidates(results)),
+        line(line), column(column) {}
+  CodeCompletionSession(const CodeCompletionSession &) = delete;
+  CodeCompletionSession &operator=(const CodeCompletionSession &) = delete;
+  ~CodeCompletionSession() {
+    if (results != nullptr) {
+      clang_disposeCodeCompleteResults(results);
+    }
+  }
+
+  // Whether the cursor at (line, column) is still within the identifier that
+  // started at the completion point and consists of prefix.
+  bool isWithinIdentifier(unsigned line, unsigned column,
+                          const std::string &prefix) const {
+    if (line != this->line || column != this->column + prefix.size()) {
+      return false;
+    }
+    return std::all_of(prefix.begin(), prefix.end(), [](char c) {
+      return isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$';
+    });
+  }
+};
+
+enum IndexEventKind {
+  IndexEventKind_Declaration = 0,
+  IndexEventKind_Reference = 1
+};
+
+// Events reported by the indexer, stored column-wise. The indexer callbacks run
+// on the thread libclang parses on, where JS must not be called, so they only
+// append here and the events are handed to JS once indexing has returned.
+struct IndexEventLog {
+  std::vector<uint8_t> kinds;
+  std::vector<uint8_t> entityKinds;
+  std::vector<uint32_t> usrs;
+  std::vector<uint32_t> names;
+  std::vector<uint32_t> files;
+  std::vector<uint32_t> lines;
+  std::vector<uint32_t> columns;
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> roles;
+  StringTable strings;
+  FileTable fileTable;
+
+  size_t size() const { return kinds.size(); }
+
+  void append(IndexEventKind kind, const CXIdxEntityInfo *entity, CXFile file,
+              unsigned line, unsigned column, unsigned offset, unsigned role) {
+    kinds.push_back(kind);
+    entityKinds.push_back(entity != nullptr ? entity->kind
+                                            : CXIdxEntity_Unexposed);
+    usrs.push_back(strings.intern(
+        entity != nullptr && entity->USR != nullptr ? entity->USR : ""));
+    names.push_back(strings.intern(
+        entity != nullptr && entity->name != nullptr ? entity->name : ""));
+    files.push_back(fileTable.intern(file));
+    lines.push_back(line);
+    columns.push_back(column);
+    offsets.push_back(offset);
+    roles.push_back(role);
+  }
+
+  // Calls callback with consecutive slices of at most batchSize events. All
+  // batches share the same string tables.
+  void flush(emscripten::val callback, size_t batchSize) const {
+    emscripten::val stringArray = strings.toJSArray();
+    emscripten::val fileArray = fileTable.names.toJSArray();
+    for (size_t begin = 0; begin < size(); begin += batchSize) {
+      size_t end = std::min(size(), begin + batchSize);
+      auto slice = [&](const auto &column) {
+        using T = typename std::decay_t<decltype(column)>::value_type;
+        return vectorToTypedArray(std::vector<T>(column.begin() + begin,
+                                                 column.begin() + end));
+      };
+      emscripten::val batch = emscripten::val::object();
+      batch.set("length", end - begin);
+      batch.set("kind", slice(kinds));
+      batch.set("entityKind", slice(entityKinds));
+      batch.set("usr", slice(usrs));
+      batch.set("name", slice(names));
+      batch.set("file", slice(files));
+      batch.set("line", slice(lines));
+      batch.set("column", slice(columns));
+      batch.set("offset", slice(offsets));
+      batch.set("role", slice(roles));
+      batch.set("strings", stringArray);
+      batch.set("files", fileArray);
+      callback(batch);
+    }
+  }
+};
+
+// Headers indexed over the lifetime of an IndexingSession. Events in headers
+// which were already indexed as part of an earlier translation unit are
+// dropped. Main files are always reported, as they may be indexed again after
+// an edit.
+struct IndexingSession {
+  CXIndexAction action;
+  std::unordered_set<std::string> indexedFiles;
+  unsigned translationUnits = 0;
+  unsigned skippedIncludes = 0;
+  unsigned importedASTFiles = 0;
+  size_t reportedEvents = 0;
+  size_t droppedEvents = 0;
+
+  explicit IndexingSession(CXIndex index)
+      : action(clang_IndexAction_create(index)) {}
+  IndexingSession(const IndexingSession &) = delete;
+  IndexingSession &operator=(const IndexingSession &) = delete;
+  ~IndexingSession() { clang_IndexAction_dispose(action); }
+};
+
+// The client data of the indexer callbacks for a single translation unit.
+struct IndexClient {
+  IndexEventLog log;
+  IndexingSession *session = nullptr;
+  // Whether events in a file are reported, cached per file.
+  std::unordered_map<CXFile, bool> reportedFiles;
+  // Files entered while indexing this translation unit.
+  std::vector<std::string> files;
+  CXFile mainFile = nullptr;
+
+  bool isReported(CXFile file) {
+    if (session == nullptr || file == mainFile) {
+      return true;
+    }
+    auto it = reportedFiles.find(file);
+    if (it == reportedFiles.end()) {
+      std::string name =
+          file == nullptr ? "" : cxStringToStdString(clang_getFileName(file));
+      it = reportedFiles.emplace(file, !session->indexedFiles.count(name))
+               .first;
+    }
+    return it->second;
+  }
+
+  void enterMainFile(CXFile file) {
+    mainFile = file;
+    enterFile(file);
+  }
+
+  void enterFile(CXFile file) {
+    if (file == nullptr) {
+      return;
+    }
+    if (session != nullptr && !isReported(file)) {
+      session->skippedIncludes++;
+    }
+    files.push_back(cxStringToStdString(clang_getFileName(file)));
+  }
+
+  void append(IndexEventKind kind, const CXIdxEntityInfo *entity, CXIdxLoc loc,
+              unsigned role) {
+    CXFile file = nullptr;
+    unsigned line = 0, column = 0, offset = 0;
+    clang_indexLoc_getFileLocation(loc, nullptr, &file, &line, &column,
+                                   &offset);
+    if (!isReported(file)) {
+      session->droppedEvents++;
+      return;
+    }
+    log.append(kind, entity, file, line, column, offset, role);
+  }
+
+  // Called after indexing has returned.
+  void finish() {
+    if (session == nullptr) {
+      return;
+    }
+    session->translationUnits++;
+    session->reportedEvents += log.size();
+    std::string mainFileName =
+        mainFile == nullptr ? ""
+                            : cxStringToStdString(clang_getFileName(mainFile));
+    for (const std::string &file : files) {
+      if (file != mainFileName) {
+        session->indexedFiles.insert(file);
+      }
+    }
+  }
+};
+
+CXIdxClientFile logEnteredMainFile(CXClientData client_data, CXFile mainFile,
+                                   void *) {
+  static_cast<IndexClient *>(client_data)->enterMainFile(mainFile);
+  return nullptr;
+}
+
+CXIdxClientFile logPPIncludedFile(CXClientData client_data,
+                                  const CXIdxIncludedFileInfo *info) {
+  static_cast<IndexClient *>(client_data)->enterFile(info->file);
+  return nullptr;
+}
+
+CXIdxClientASTFile logImportedASTFile(CXClientData client_data,
+                                      const CXIdxImportedASTFileInfo *) {
+  auto *client = static_cast<IndexClient *>(client_data);
+  if (client->session != nullptr) {
+    client->session->importedASTFiles++;
+  }
+  return nullptr;
+}
+
+void logIndexDeclaration(CXClientData client_data, const CXIdxDeclInfo *info) {
+  unsigned role = CXSymbolRole_Declaration;
+  if (info->isDefinition) {
+    role |= CXSymbolRole_Definition;
+  }
+  if (info->isImplicit) {
+    role |= CXSymbolRole_Implicit;
+  }
+  static_cast<IndexClient *>(client_data)
+      ->append(IndexEventKind_Declaration, info->entityInfo, info->loc, role);
+}
+
+void logIndexEntityReference(CXClientData client_data,
+                             const CXIdxEntityRefInfo *info) {
+  static_cast<IndexClient *>(client_data)
+      ->append(IndexEventKind_Reference, info->referencedEntity, info->loc,
+               info->role);
+}
+
+IndexerCallbacks indexClientCallbacks() {
+  IndexerCallbacks callbacks = {};
+  callbacks.enteredMainFile = &logEnteredMainFile;
+  callbacks.ppIncludedFile = &logPPIncludedFile;
+  callbacks.importedASTFile = &logImportedASTFile;
+  callbacks.indexDeclaration = &logIndexDeclaration;
+  callbacks.indexEntityReference = &logIndexEntityReference;
+  return callbacks;
+}
+
+int indexSourceFile(CXIndexAction action, IndexClient &client,
+                    unsigned index_options, emscripten::val source_filename,
+                    emscripten::val command_line_args,
+                    emscripten::val unsaved_files, unsigned TU_options) {
+  Arena arena;
+  auto [convertedCommandLineArgs, numConvertedCommandLineArgs] =
+      convertJSStringArray(command_line_args, arena);
+  auto [convertedUnsavedFiles, numConvertedUnsavedFiles] =
+      convertUnsavedFiles(unsaved_files, arena);
+  IndexerCallbacks callbacks = indexClientCallbacks();
+  int ret = clang_indexSourceFile(
+      action, &client, &callbacks, sizeof(callbacks), index_options,
+      (source_filename.isNull() || source_filename.isUndefined())
+          ? nullptr
+          : source_filename.as<std::string>().c_str(),
+      convertedCommandLineArgs, numConvertedCommandLineArgs,
+      convertedUnsavedFiles, numConvertedUnsavedFiles, nullptr, TU_options);
+  client.finish();
+  return ret;
+}
+
+// Maps USRs to the locations where they are declared, defined or referenced.
+// Records are grouped by file, so that a file can be re-indexed on its own. A
+// lookup table sorted by USR is rebuilt lazily after modifications.
+//
+// The binary format, in native (little) endianness, is
+//   "LCJSYMIX", version, string count, record count (uint32 each)
+//   string offsets (string count + 1 uint32), string bytes
+//   records (usr, file, line, column, offset, role as uint32), sorted by USR
+// The strings are sorted, so string ids order like the strings themselves.
+struct SymbolIndex {
+  struct Record {
+    uint32_t usr;
+    uint32_t file;
+    uint32_t line;
+    uint32_t column;
+    uint32_t offset;
+    uint32_t role;
+  };
+  static constexpr char Magic[8] = {'L', 'C', 'J', 'S', 'Y', 'M', 'I', 'X'};
+  static constexpr uint32_t Version = 1;
+
+  StringTable strings;
+  std::map<uint32_t, std::vector<Record>> recordsByFile;
+  std::vector<const Record *> lookupTable;
+  bool lookupTableValid = false;
+
+  void removeFile(uint32_t file) {
+    recordsByFile.erase(file);
+    lookupTableValid = false;
+  }
+
+  // Replaces the records of every file entered while indexing or containing
+  // an event. Includes are not reported when indexing a translation unit
+  // without a detailed preprocessing record, so entered files do not suffice.
+  void update(const IndexClient &client) {
+    const IndexEventLog &log = client.log;
+    for (const std::string &file : client.files) {
+      removeFile(strings.intern(file));
+    }
+    for (const std::string &file : log.fileTable.names.strings) {
+      if (!file.empty()) {
+        removeFile(strings.intern(file));
+      }
+    }
+    // Maps ids of the log's string tables to ids of this index, on demand.
+    auto mapper = [&](const StringTable &table) {
+      return [&, ids = std::vector<uint32_t>(table.strings.size(), UINT32_MAX)](
+                 uint32_t id) mutable {
+        if (ids[id] == UINT32_MAX) {
+          ids[id] = strings.intern(table.strings[id]);
+        }
+        return ids[id];
+      };
+    };
+    auto mapUsr = mapper(log.strings);
+    auto mapFile = mapper(log.fileTable.names);
+    for (size_t i = 0; i < log.size(); i++) {
+      if (log.strings.strings[log.usrs[i]].empty() ||
+          log.fileTable.names.strings[log.files[i]].empty()) {
+        continue;
+      }
+      uint32_t file = mapFile(log.files[i]);
+      recordsByFile[file].push_back({mapUsr(log.usrs[i]), file, log.lines[i],
+                                     log.columns[i], log.offsets[i],
+                                     log.roles[i]});
+    }
+    lookupTableValid = false;
+  }
+
+  const std::vector<const Record *> &getLookupTable() {
+    if (!lookupTableValid) {
+      lookupTable.clear();
+      for (const auto &[file, records] : recordsByFile) {
+        for (const Record &record : records) {
+          lookupTable.push_back(&record);
+        }
+      }
+      std::stable_sort(lookupTable.begin(), lookupTable.end(),
+                       [&](const Record *a, const Record *b) {
+                         return strings.strings[a->usr] <
+                                strings.strings[b->usr];
+                       });
+      lookupTableValid = true;
+    }
+    return lookupTable;
+  }
+
+  // Returns the records whose USR is usr or, with prefix set, starts with usr.
+  emscripten::val lookup(const std::string &usr, bool prefix) {
+    const std::vector<const Record *> &table = getLookupTable();
+    auto begin = std::lower_bound(
+        table.begin(), table.end(), usr,
+        [&](const Record *record, const std::string &usr) {
+          return strings.strings[record->usr] < usr;
+        });
+    auto end = begin;
+    auto matches = [&](const std::string &candidate) {
+      return prefix ? candidate.compare(0, usr.size(), usr) == 0
+                    : candidate == usr;
+    };
+    while (end != table.end() && matches(strings.strings[(*end)->usr])) {
+      ++end;
+    }
+    StringTable resultStrings;
+    std::vector<uint32_t> resultUsrs, resultFiles, lines, columns, offsets,
+        roles;
+    for (auto it = begin; it != end; ++it) {
+      resultUsrs.push_back(resultStrings.intern(strings.strings[(*it)->usr]));
+      resultFiles.push_back(resultStrings.intern(strings.strings[(*it)->file]));
+      lines.push_back((*it)->line);
+      columns.push_back((*it)->column);
+      offsets.push_back((*it)->offset);
+      roles.push_back((*it)->role);
+    }
+    emscripten::val ret = emscripten::val::object();
+    ret.set("length", resultUsrs.size());
+    ret.set("usr", vectorToTypedArray(resultUsrs));
+    ret.set("file", vectorToTypedArray(resultFiles));
+    ret.set("line", vectorToTypedArray(lines));
+    ret.set("column", vectorToTypedArray(columns));
+    ret.set("offset", vectorToTypedArray(offsets));
+    ret.set("role", vectorToTypedArray(roles));
+    ret.set("strings", resultStrings.toJSArray());
+    return ret;
+  }
+
+  bool save(const std::string &filename) {
+    // Only strings which are still referenced are written, in sorted order.
+    std::vector<uint32_t> used;
+    std::vector<bool> isUsed(strings.strings.size());
+    std::vector<Record> records;
+    for (const auto &[file, fileRecords] : recordsByFile) {
+      for (const Record &record : fileRecords) {
+        for (uint32_t id : {record.usr, record.file}) {
+          if (!isUsed[id]) {
+            isUsed[id] = true;
+            used.push_back(id);
+          }
+        }
+        records.push_back(record);
+      }
+    }
+    std::sort(used.begin(), used.end(), [&](uint32_t a, uint32_t b) {
+      return strings.strings[a] < strings.strings[b];
+    });
+    std::vector<uint32_t> remap(strings.strings.size());
+    std::vector<uint32_t> stringOffsets{0};
+    std::string stringBytes;
+    for (size_t i = 0; i < used.size(); i++) {
+      remap[used[i]] = i;
+      stringBytes += strings.strings[used[i]];
+      stringOffsets.push_back(stringBytes.size());
+    }
+    for (Record &record : records) {
+      record.usr = remap[record.usr];
+      record.file = remap[record.file];
+    }
+    std::sort(records.begin(), records.end(),
+              [](const Record &a, const Record &b) {
+                return std::tie(a.usr, a.file, a.offset) <
+                       std::tie(b.usr, b.file, b.offset);
+              });
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    uint32_t header[3] = {Version, static_cast<uint32_t>(used.size()),
+                          static_cast<uint32_t>(records.size())};
+    out.write(Magic, sizeof(Magic));
+    out.write(reinterpret_cast<const char *>(header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(stringOffsets.data()),
+              stringOffsets.size() * sizeof(uint32_t));
+    out.write(stringBytes.data(), stringBytes.size());
+    out.write(reinterpret_cast<const char *>(records.data()),
+              records.size() * sizeof(Record));
+    return static_cast<bool>(out);
+  }
+
+  // Replaces the contents of this index. Leaves it unchanged on failure.
+  bool load(const std::string &filename) {
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
+    if (!in) {
+      return false;
+    }
+    std::string data(static_cast<size_t>(in.tellg()), '\0');
+    in.seekg(0);
+    if (!in.read(data.data(), data.size())) {
+      return false;
+    }
+    uint32_t header[3];
+    if (data.size() < sizeof(Magic) + sizeof(header) ||
+        memcmp(data.data(), Magic, sizeof(Magic)) != 0) {
+      return false;
+    }
+    memcpy(header, data.data() + sizeof(Magic), sizeof(header));
+    auto [version, numStrings, numRecords] = header;
+    size_t pos = sizeof(Magic) + sizeof(header);
+    size_t offsetsSize = (size_t(numStrings) + 1) * sizeof(uint32_t);
+    if (version != Version || data.size() < pos + offsetsSize) {
+      return false;
+    }
+    std::vector<uint32_t> stringOffsets(numStrings + 1);
+    memcpy(stringOffsets.data(), data.data() + pos, offsetsSize);
+    pos += offsetsSize;
+    size_t recordsPos = pos + stringOffsets.back();
+    if (data.size() != recordsPos + size_t(numRecords) * sizeof(Record)) {
+      return false;
+    }
+    StringTable loadedStrings;
+    for (uint32_t i = 0; i < numStrings; i++) {
+      if (stringOffsets[i] > stringOffsets[i + 1]) {
+        return false;
+      }
+      loadedStrings.intern(
+          data.substr(pos + stringOffsets[i],
+                      stringOffsets[i + 1] - stringOffsets[i]));
+    }
+    std::map<uint32_t, std::vector<Record>> loadedRecords;
+    for (uint32_t i = 0; i < numRecords; i++) {
+      Record record;
+      memcpy(&record, data.data() + recordsPos + i * sizeof(Record),
+             sizeof(Record));
+      if (record.usr >= numStrings || record.file >= numStrings) {
+        return false;
+      }
+      loadedRecords[record.file].push_back(record);
+    }
+    strings = std::move(loadedStrings);
+    recordsByFile = std::move(loadedRecords);
+    lookupTableValid = false;
+    return true;
+  }
+};
+
+size_t convertBatchSize(emscripten::val batchSize) {
+  return (batchSize.isNull() || batchSize.isUndefined())
+             ? 1024
+             : std::max(1u, batchSize.as<unsigned>());
+}
+
+// A precompiled header covering a fixed set of system headers, e.g. the C++
+// standard library, built for a fixed set of command line arguments.
+struct PchBundle {
+  std::string file;
+  std::unordered_set<std::string> headers;
+  std::vector<std::string> args;
+};
+
+// Parse settings which libclangjs keeps per index. Parses may run on any
+// thread, hence the lock.
+struct IndexSettings {
+  std::string preambleCacheDirectory;
+  std::vector<PchBundle> pchBundles;
+};
+std::mutex indexSettingsMutex;
+std::unordered_map<CXIndex, IndexSettings> indexSettings;
+
+IndexSettings getIndexSettings(CXIndex index) {
+  std::lock_guard<std::mutex> lock(indexSettingsMutex);
+  auto it = indexSettings.find(index);
+  return it == indexSettings.end() ? IndexSettings() : it->second;
+}
+
+struct Preamble {
+  size_t length = 0;
+  // Included files as written, e.g. <vector> or "header.hpp".
+  std::vector<std::string> includes;
+  // Whether the preamble consists of #include directives only.
+  bool includesOnly = true;
+};
+
+// Returns the leading part of a source file made of blank lines, comments and
+// #include, #import, #define, #undef and #pragma directives. Conditional
+// directives end the preamble, since it must not cut through a conditional
+// block.
+Preamble computePreamble(const std::string &source) {
+  Preamble preamble;
+  size_t pos = 0;
+  while (pos < source.size()) {
+    char c = source[pos];
+    if (isspace(static_cast<unsigned char>(c))) {
+      pos++;
+    } else if (source.compare(pos, 2, "//") == 0) {
+      pos = std::min(source.find('\n', pos), source.size());
+    } else if (source.compare(pos, 2, "/*") == 0) {
+      size_t close = source.find("*/", pos + 2);
+      if (close == std::string::npos) {
+        break;
+      }
+      pos = close + 2;
+    } else if (c == '#') {
+      size_t directive = source.find_first_not_of(" \t", pos + 1);
+      if (directive == std::string::npos) {
+        break;
+      }
+      size_t directiveEnd = directive;
+      while (directiveEnd < source.size() &&
+             isalpha(static_cast<unsigned char>(source[directiveEnd]))) {
+        directiveEnd++;
+      }
+      std::string name = source.substr(directive, directiveEnd - directive);
+      if (name != "include" && name != "import" && name != "define" &&
+          name != "undef" && name != "pragma") {
+        break;
+      }
+      // Directives may continue on the next line after a backslash.
+      do {
+        pos = std::min(source.find('\n', pos), source.size());
+      } while (pos < source.size() && pos > 0 && source[pos - 1] == '\\' &&
+               ++pos);
+      if (name == "include" || name == "import") {
+        size_t begin = source.find_first_not_of(" \t", directiveEnd);
+        size_t end = begin == std::string::npos || begin >= pos
+                         ? std::string::npos
+                         : source.find(source[begin] == '<' ? '>' : '"',
+                                       begin + 1);
+        if (end != std::string::npos && end < pos &&
+            (source[begin] == '<' || source[begin] == '"')) {
+          preamble.includes.push_back(source.substr(begin, end - begin + 1));
+        } else {
+          preamble.includesOnly = false;
+        }
+        preamble.includesOnly &= name == "include";
+      } else {
+        preamble.includesOnly = false;
+      }
+      preamble.length = pos;
+    } else {
+      break;
+    }
+  }
+  if (preamble.includes.empty()) {
+    preamble.length = 0;
+  }
+  return preamble;
+}
+
+// Returns a bundle which precompiles all includes of the given preamble and
+// whose arguments appear, in order, on the given command line.
+const PchBundle *findPchBundle(const std::vector<PchBundle> &bundles,
+                               const Preamble &preamble,
+                               const char *const *command_line_args,
+                               int num_command_line_args) {
+  if (!preamble.includesOnly || preamble.includes.empty()) {
+    return nullptr;
+  }
+  for (const PchBundle &bundle : bundles) {
+    bool coversIncludes =
+        std::all_of(preamble.includes.begin(), preamble.includes.end(),
+                    [&](const std::string &include) {
+                      return bundle.headers.count(include) > 0;
+                    });
+    auto argsEnd = command_line_args + num_command_line_args;
+    bool matchesArgs =
+        std::search(command_line_args, argsEnd, bundle.args.begin(),
+                    bundle.args.end(),
+                    [](const char *arg, const std::string &bundleArg) {
+                      return bundleArg == arg;
+                    }) != argsEnd ||
+        bundle.args.empty();
+    if (coversIncludes && matchesArgs) {
+      return &bundle;
+    }
+  }
+  return nullptr;
+}
+
+// Returns the value of a JSON text, or undefined if the text is malformed.
+EM_JS(emscripten::EM_VAL, parseJSON, (const char *text), {
+  try {
+    return Emval.toHandle(JSON.parse(UTF8ToString(text)));
+  } catch (e) {
+    return Emval.toHandle(undefined);
+  }
+});
+
+bool convertStringArray(emscripten::val v, std::vector<std::string> &out) {
+  if (!v.isArray()) {
+    return false;
+  }
+  for (const emscripten::val &element :
+       emscripten::vecFromJSArray<emscripten::val>(v)) {
+    if (!element.isString()) {
+      return false;
+    }
+    out.push_back(element.as<std::string>());
+  }
+  return true;
+}
+
+// Reads the bundles listed in a manifest written by buildStdlibPch.ts. Bundle
+// files are relative to the directory of the manifest. Returns false if the
+// manifest cannot be read or is malformed.
+bool loadPchBundles(const std::string &path, std::vector<PchBundle> &bundles) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in.good()) {
+    return false;
+  }
+  std::string text((std::istreambuf_iterator<char>(in)),
+                   std::istreambuf_iterator<char>());
+  emscripten::val manifest =
+      emscripten::val::take_ownership(parseJSON(text.c_str()));
+  if (manifest.isNull() || manifest.isUndefined() ||
+      !manifest["bundles"].isArray()) {
+    return false;
+  }
+  size_t slash = path.find_last_of('/');
+  std::string directory =
+      slash == std::string::npos ? "" : path.substr(0, slash + 1);
+  for (const emscripten::val &entry :
+       emscripten::vecFromJSArray<emscripten::val>(manifest["bundles"])) {
+    PchBundle bundle;
+    std::vector<std::string> headers;
+    if (entry.isNull() || entry.isUndefined() || !entry["file"].isString() ||
+        !convertStringArray(entry["headers"], headers) ||
+        !convertStringArray(entry["args"], bundle.args)) {
+      return false;
+    }
+    bundle.file = directory + entry["file"].as<std::string>();
+    bundle.headers.insert(headers.begin(), headers.end());
+    bundles.push_back(std::move(bundle));
+  }
+  return true;
+}
+
+uint64_t fnv1a(const char *data, size_t length, uint64_t hash) {
+  for (size_t i = 0; i < length; i++) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+bool hasFatalDiagnostic(CXTranslationUnit tu) {
+  for (unsigned i = 0; i < clang_getNumDiagnostics(tu); i++) {
+    CXDiagnostic diagnostic = clang_getDiagnostic(tu, i);
+    CXDiagnosticSeverity severity = clang_getDiagnosticSeverity(diagnostic);
+    clang_disposeDiagnostic(diagnostic);
+    if (severity == CXDiagnostic_Fatal) {
+      return true;
+    }
+  }
+  return false;
+}
+
+unsigned countErrors(CXTranslationUnit tu) {
+  unsigned errors = 0;
+  for (unsigned i = 0; i < clang_getNumDiagnostics(tu); i++) {
+    CXDiagnostic diagnostic = clang_getDiagnostic(tu, i);
+    if (clang_getDiagnosticSeverity(diagnostic) >= CXDiagnostic_Error) {
+      errors++;
+    }
+    clang_disposeDiagnostic(diagnostic);
+  }
+  return errors;
+}
+
+// Whether the main file includes a header without an include guard or #pragma
+// once. A source file parsed with a PCH of such a header enters it again and
+// redefines everything it declares.
+bool includesUnguardedHeader(CXTranslationUnit tu) {
+  std::pair<CXTranslationUnit, bool> data(tu, false);
+  clang_getInclusions(
+      tu,
+      [](CXFile file, CXSourceLocation *stack, unsigned length,
+         CXClientData client_data) {
+        auto *data =
+            static_cast<std::pair<CXTranslationUnit, bool> *>(client_data);
+        if (length == 1 && clang_Location_isFromMainFile(stack[0]) &&
+            !clang_isFileMultipleIncludeGuarded(data->first, file)) {
+          data->second = true;
+        }
+      },
+      &data);
+  return data.second;
+}
+
+// Every translation unit created through libclangjs and not yet disposed, used
+// to aggregate resource usage per index. Translation units with asynchronous
+// jobs in flight are in use on another thread and must not be queried or
+// modified; disposing them is deferred until their last job has finished.
+struct LiveTranslationUnit {
+  CXIndex index;
+  unsigned pendingJobs = 0;
+  bool disposeWhenIdle = false;
+};
+std::mutex liveTranslationUnitsMutex;
+std::unordered_map<CXTranslationUnit, LiveTranslationUnit> liveTranslationUnits;
+
+CXTranslationUnit registerTranslationUnit(CXIndex index, CXTranslationUnit tu) {
+  if (tu != nullptr) {
+    std::lock_guard<std::mutex> lock(liveTranslationUnitsMutex);
+    liveTranslationUnits[tu] = {index};
+  }
+  return tu;
+}
+
+void addPendingJobs(CXTranslationUnit tu, int count) {
+  {
+    std::lock_guard<std::mutex> lock(liveTranslationUnitsMutex);
+    auto it = liveTranslationUnits.find(tu);
+    if (it == liveTranslationUnits.end()) {
+      return;
+    }
+    it->second.pendingJobs += count;
+    if (it->second.pendingJobs > 0 || !it->second.disposeWhenIdle) {
+      return;
+    }
+    liveTranslationUnits.erase(it);
+  }
+  clang_disposeTranslationUnit(tu);
+}
+
+bool hasPendingJobs(CXTranslationUnit tu) {
+  std::lock_guard<std::mutex> lock(liveTranslationUnitsMutex);
+  auto it = liveTranslationUnits.find(tu);
+  return it != liveTranslationUnits.end() && it->second.pendingJobs > 0;
+}
+
+void disposeTranslationUnit(CXTranslationUnit tu) {
+  {
+    std::lock_guard<std::mutex> lock(liveTranslationUnitsMutex);
+    auto it = liveTranslationUnits.find(tu);
+    if (it != liveTranslationUnits.end() && it->second.pendingJobs > 0) {
+      it->second.disposeWhenIdle = true;
+      return;
+    }
+    liveTranslationUnits.erase(tu);
+  }
+  clang_disposeTranslationUnit(tu);
+}
+
+// Adds the resource usage of a translation unit to a total per kind.
+void addTUResourceUsage(CXTranslationUnit tu,
+                        std::map<CXTUResourceUsageKind, double> &bytesByKind) {
+  CXTUResourceUsage usage = clang_getCXTUResourceUsage(tu);
+  for (unsigned i = 0; i < usage.numEntries; i++) {
+    bytesByKind[usage.entries[i].kind] += usage.entries[i].amount;
+  }
+  clang_disposeCXTUResourceUsage(usage);
+}
+
+emscripten::val encodeTUResourceUsage(
+    const std::map<CXTUResourceUsageKind, double> &bytesByKind) {
+  std::vector<uint32_t> kinds;
+  std::vector<double> bytes;
+  for (const auto &[kind, amount] : bytesByKind) {
+    kinds.push_back(kind);
+    bytes.push_back(amount);
+  }
+  emscripten::val ret = emscripten::val::object();
+  ret.set("kind", vectorToTypedArray(kinds));
+  ret.set("bytes", vectorToTypedArray(bytes));
+  return ret;
+}
+
+// Paths of PCH files which are not built or used, because their preamble
+// includes a header without an include guard, because a parse with them had
+// more errors than a plain parse, or because they could not be used right
+// after being rebuilt.
+std::mutex uncachedPreamblesMutex;
+std::unordered_set<std::string> uncachedPreambles;
+// Paths of PCH files a parse with errors has been compared to a plain parse
+// for. Parses with them are not compared again.
+std::unordered_set<std::string> comparedPchs;
+
+bool isUncachedPreamble(const std::string &pchPath) {
+  std::lock_guard<std::mutex> lock(uncachedPreamblesMutex);
+  return uncachedPreambles.count(pchPath) > 0;
+}
+
+void addUncachedPreamble(const std::string &pchPath) {
+  std::lock_guard<std::mutex> lock(uncachedPreamblesMutex);
+  uncachedPreambles.insert(pchPath);
+}
+
+// Parses like clang_parseTranslationUnit2, reusing precompiled headers where
+// the index allows it. A source file whose preamble only includes headers of a
+// PCH bundle is parsed with that bundle. Otherwise, if the index has a
+// preamble cache directory, the preamble of the source file is precompiled
+// into that directory, keyed by a hash of the preamble and the command line.
+// PCH files are passed to clang via -include-pch, so the includes of the
+// preamble are processed again, which only headers with include guards allow.
+// A cached PCH is rebuilt once if it cannot be used, e.g. because one of its
+// headers has changed, and left out from then on if the rebuilt one cannot be
+// used either. The first parse with errors for each PCH is compared to a plain
+// parse. If that has fewer errors, the PCH is left out from then on.
+CXErrorCode parseWithCaches(
+    CXIndex index, const char *source_filename,
+    const char *const *command_line_args, int num_command_line_args,
+    CXUnsavedFile *unsaved_files, unsigned num_unsaved_files, unsigned options,
+    CXTranslationUnit *out_TU) {
+  // A plain parse is made at most once, either as the result or to compare
+  // the errors of a parse with a PCH against.
+  bool parsedPlain = false;
+  CXErrorCode plainRet = CXError_Failure;
+  CXTranslationUnit plainTu = nullptr;
+  auto parse = [&]() {
+    if (!parsedPlain) {
+      plainRet = clang_parseTranslationUnit2(
+          index, source_filename, command_line_args, num_command_line_args,
+          unsaved_files, num_unsaved_files, options, &plainTu);
+      parsedPlain = true;
+    }
+    *out_TU = plainTu;
+    return plainRet;
+  };
+  IndexSettings settings = getIndexSettings(index);
+  std::string &directory = settings.preambleCacheDirectory;
+  if ((directory.empty() && settings.pchBundles.empty()) ||
+      source_filename == nullptr) {
+    return parse();
+  }
+
+  std::string source;
+  auto unsavedFile = std::find_if(
+      unsaved_files, unsaved_files + num_unsaved_files,
+      [&](const CXUnsavedFile &f) {
+        return strcmp(f.Filename, source_filename) == 0;
+      });
+  if (unsavedFile != unsaved_files + num_unsaved_files) {
+    source.assign(unsavedFile->Contents, unsavedFile->Length);
+  } else {
+    std::ifstream in(source_filename, std::ios::binary);
+    source.assign(std::istreambuf_iterator<char>(in),
+                  std::istreambuf_iterator<char>());
+  }
+  Preamble preamble = computePreamble(source);
+  if (preamble.length == 0) {
+    return parse();
+  }
+
+  std::vector<const char *> args(command_line_args,
+                                 command_line_args + num_command_line_args);
+  auto parseWithPch = [&](const std::string &pchPath) {
+    std::vector<const char *> pchArgs = args;
+    pchArgs.push_back("-include-pch");
+    pchArgs.push_back(pchPath.c_str());
+    CXTranslationUnit tu = nullptr;
+    CXErrorCode ret = clang_parseTranslationUnit2(
+        index, source_filename, pchArgs.data(), pchArgs.size(), unsaved_files,
+        num_unsaved_files, options, &tu);
+    if (ret != CXError_Success) {
+      return ret;
+    }
+    if (hasFatalDiagnostic(tu)) {
+      clang_disposeTranslationUnit(tu);
+      return CXError_Failure;
+    }
+    unsigned errors = countErrors(tu);
+    bool compare = false;
+    if (errors > 0) {
+      std::lock_guard<std::mutex> lock(uncachedPreamblesMutex);
+      compare = comparedPchs.insert(pchPath).second;
+    }
+    if (compare && parse() == CXError_Success &&
+        countErrors(plainTu) < errors) {
+      clang_disposeTranslationUnit(tu);
+      addUncachedPreamble(pchPath);
+      return CXError_Failure;
+    }
+    if (plainTu != nullptr) {
+      clang_disposeTranslationUnit(plainTu);
+    }
+    *out_TU = tu;
+    return ret;
+  };
+  const PchBundle *bundle = findPchBundle(
+      settings.pchBundles, preamble, command_line_args, num_command_line_args);
+  if (bundle != nullptr && !isUncachedPreamble(bundle->file) &&
+      parseWithPch(bundle->file) == CXError_Success) {
+    return CXError_Success;
+  }
+  if (directory.empty()) {
+    return parse();
+  }
+
+  uint64_t hash = fnv1a(source.data(), preamble.length, 0xcbf29ce484222325ull);
+  for (int i = 0; i < num_command_line_args; i++) {
+    hash = fnv1a(command_line_args[i], strlen(command_line_args[i]) + 1, hash);
+  }
+  char key[17];
+  snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+  std::string pchPath = directory + "/" + key + ".pch";
+
+  if (isUncachedPreamble(pchPath)) {
+    return parse();
+  }
+  if (std::ifstream(pchPath).good()) {
+    if (parseWithPch(pchPath) == CXError_Success) {
+      return CXError_Success;
+    }
+    // A PCH with more errors than a plain parse is not rebuilt.
+    if (isUncachedPreamble(pchPath)) {
+      return parse();
+    }
+    remove(pchPath.c_str());
+  }
+
+  // The preamble is compiled as a header in the cache directory, passed as an
+  // unsaved file, so that no header has to exist when the PCH is loaded.
+  // Quoted includes are then looked up in the directory of the source file.
+  // The PCH is written under a name unique to this thread and renamed into
+  // place, as parseMany may build the same preamble on several threads.
+  std::string unique = std::to_string(
+      std::hash<std::thread::id>()(std::this_thread::get_id()));
+  std::string sourceDirectory = source_filename;
+  size_t slash = sourceDirectory.find_last_of('/');
+  sourceDirectory =
+      slash == std::string::npos ? "." : sourceDirectory.substr(0, slash);
+  size_t dot = std::string(source_filename).find_last_of('.');
+  bool isC = dot != std::string::npos &&
+             std::string(source_filename).substr(dot) == ".c";
+  std::string headerPath = directory + "/" + key + (isC ? ".h" : ".hpp");
+  std::string header = source.substr(0, preamble.length) + '\n';
+  std::vector<CXUnsavedFile> headerUnsavedFiles(
+      unsaved_files, unsaved_files + num_unsaved_files);
+  headerUnsavedFiles.push_back(
+      {headerPath.c_str(), header.data(), header.size()});
+  std::string temporaryPchPath = pchPath + "." + unique;
+  std::vector<const char *> headerArgs = args;
+  headerArgs.push_back("-iquote");
+  headerArgs.push_back(sourceDirectory.c_str());
+  CXTranslationUnit pchTu = nullptr;
+  CXErrorCode ret = clang_parseTranslationUnit2(
+      index, headerPath.c_str(), headerArgs.data(), headerArgs.size(),
+      headerUnsavedFiles.data(), headerUnsavedFiles.size(),
+      CXTranslationUnit_Incomplete | CXTranslationUnit_ForSerialization,
+      &pchTu);
+  if (ret == CXError_Success) {
+    if (includesUnguardedHeader(pchTu)) {
+      clang_disposeTranslationUnit(pchTu);
+      addUncachedPreamble(pchPath);
+      return parse();
+    }
+    bool saved =
+        !hasFatalDiagnostic(pchTu) &&
+        clang_saveTranslationUnit(pchTu, temporaryPchPath.c_str(), 0) == 0 &&
+        rename(temporaryPchPath.c_str(), pchPath.c_str()) == 0;
+    clang_disposeTranslationUnit(pchTu);
+    remove(temporaryPchPath.c_str());
+    if (saved) {
+      {
+        std::lock_guard<std::mutex> lock(uncachedPreamblesMutex);
+        comparedPchs.erase(pchPath);
+      }
+      if (parseWithPch(pchPath) == CXError_Success) {
+        return CXError_Success;
+      }
+      addUncachedPreamble(pchPath);
+    }
+    remove(pchPath.c_str());
+  }
+  return parse();
+}
+
+// Parses with parseWithCaches() and registers the translation unit.
+CXErrorCode parseTranslationUnitWithCaches(
+    CXIndex index, const char *source_filename,
+    const char *const *command_line_args, int num_command_line_args,
+    CXUnsavedFile *unsaved_files, unsigned num_unsaved_files, unsigned options,
+    CXTranslationUnit *out_TU) {
+  CXErrorCode ret = parseWithCaches(index, source_filename, command_line_args,
+                                    num_command_line_args, unsaved_files,
+                                    num_unsaved_files, options, out_TU);
+  registerTranslationUnit(index, *out_TU);
+  return ret;
+}
+
+// Returns the memory in bytes clang reports for a translation unit.
+size_t getTUMemoryUsage(CXTranslationUnit tu) {
+  std::map<CXTUResourceUsageKind, double> bytesByKind;
+  addTUResourceUsage(tu, bytesByKind);
+  double bytes = 0;
+  for (const auto &entry : bytesByKind) {
+    bytes += entry.second;
+  }
+  return static_cast<size_t>(bytes);
+}
+
+// Translation units keyed by source file, command line and parse options,
+// kept in least recently used order. When the memory of all entries exceeds
+// the budget, the coldest entries are suspended first and disposed after
+// that. Translation units returned by get() are pinned until they are
+// released and are neither suspended nor disposed in the meantime.
+struct TranslationUnitCache {
+  struct Entry {
+    std::string key;
+    CXTranslationUnit tu;
+    size_t bytes;
+    bool suspended;
+    // Hash of the unsaved files of the last parse.
+    uint64_t unsavedFilesHash;
+    // Calls of get() returning this translation unit which were not released.
+    unsigned pins;
+  };
+
+  CXIndex index;
+  size_t budget;
+  // Front is most recently used.
+  std::list<Entry> entries;
+  std::unordered_map<std::string, std::list<Entry>::iterator> entriesByKey;
+  // Pinned translation units which are not in the cache, because they failed
+  // to reparse, or because they were parsed while the cached one was pinned
+  // with other unsaved files. They are disposed once released.
+  std::unordered_map<CXTranslationUnit, unsigned> uncachedPins;
+  size_t bytes = 0;
+  size_t hits = 0;
+  size_t misses = 0;
+  size_t suspensions = 0;
+  size_t evictions = 0;
+
+  TranslationUnitCache(CXIndex index, size_t budget)
+      : index(index), budget(budget) {}
+  TranslationUnitCache(const TranslationUnitCache &) = delete;
+  TranslationUnitCache &operator=(const TranslationUnitCache &) = delete;
+  ~TranslationUnitCache() {
+    for (Entry &entry : entries) {
+      disposeTranslationUnit(entry.tu);
+    }
+    for (const auto &[tu, pins] : uncachedPins) {
+      disposeTranslationUnit(tu);
+    }
+  }
+
+  static std::string makeKey(const std::string &filename,
+                             const char *const *args, unsigned nargs,
+                             unsigned options) {
+    uint64_t hash = fnv1a(reinterpret_cast<const char *>(&options),
+                          sizeof(options), 0xcbf29ce484222325ull);
+    for (unsigned i = 0; i < nargs; i++) {
+      hash = fnv1a(args[i], strlen(args[i]) + 1, hash);
+    }
+    char suffix[18];
+    snprintf(suffix, sizeof(suffix), ":%016llx",
+             static_cast<unsigned long long>(hash));
+    return filename + suffix;
+  }
+
+  static uint64_t hashUnsavedFiles(const CXUnsavedFile *unsaved_files,
+                                   unsigned num_unsaved_files) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (unsigned i = 0; i < num_unsaved_files; i++) {
+      const CXUnsavedFile &file = unsaved_files[i];
+      hash = fnv1a(file.Filename, strlen(file.Filename) + 1, hash);
+      hash = fnv1a(reinterpret_cast<const char *>(&file.Length),
+                   sizeof(file.Length), hash);
+      hash = fnv1a(file.Contents, file.Length, hash);
+    }
+    return hash;
+  }
+
+  void measure(Entry &entry) {
+    bytes -= entry.bytes;
+    entry.bytes = getTUMemoryUsage(entry.tu);
+    bytes += entry.bytes;
+  }
+
+  // Removes an entry and disposes its translation unit, unless it is pinned.
+  std::list<Entry>::iterator erase(std::list<Entry>::iterator it) {
+    bytes -= it->bytes;
+    if (it->pins > 0) {
+      uncachedPins[it->tu] = it->pins;
+    } else {
+      disposeTranslationUnit(it->tu);
+    }
+    entriesByKey.erase(it->key);
+    return entries.erase(it);
+  }
+
+  void enforceBudget() {
+    for (auto it = entries.rbegin(); bytes > budget && it != entries.rend();
+         ++it) {
+      if (it->pins == 0 && !it->suspended &&
+          clang_suspendTranslationUnit(it->tu)) {
+        it->suspended = true;
+        suspensions++;
+        measure(*it);
+      }
+    }
+    for (auto it = entries.end(); bytes > budget && it != entries.begin();) {
+      --it;
+      if (it->pins == 0) {
+        it = erase(it);
+        evictions++;
+      }
+    }
+  }
+
+  CXTranslationUnit get(const char *source_filename,
+                        const char *const *command_line_args,
+                        unsigned num_command_line_args,
+                        CXUnsavedFile *unsaved_files,
+                        unsigned num_unsaved_files, unsigned options) {
+    std::string key = makeKey(source_filename, command_line_args,
+                              num_command_line_args, options);
+    uint64_t unsavedFilesHash =
+        hashUnsavedFiles(unsaved_files, num_unsaved_files);
+    auto found = entriesByKey.find(key);
+    if (found != entriesByKey.end() && found->second->pins > 0 &&
+        found->second->unsavedFilesHash != unsavedFilesHash) {
+      // A pinned translation unit is in use and must not be reparsed, so the
+      // caller gets an uncached one of its own.
+      misses++;
+      CXTranslationUnit tu = nullptr;
+      parseTranslationUnitWithCaches(index, source_filename, command_line_args,
+                                     num_command_line_args, unsaved_files,
+                                     num_unsaved_files, options, &tu);
+      if (tu != nullptr) {
+        uncachedPins[tu] = 1;
+      }
+      return tu;
+    }
+    if (found != entriesByKey.end()) {
+      auto it = found->second;
+      // Suspended translation units and those parsed with other unsaved files
+      // are brought up to date by reparsing them.
+      if ((it->suspended || it->unsavedFilesHash != unsavedFilesHash) &&
+          clang_reparseTranslationUnit(
+              it->tu, num_unsaved_files, unsaved_files,
+              clang_defaultReparseOptions(it->tu)) != 0) {
+        // A translation unit which failed to reparse must be disposed.
+        erase(it);
+      } else {
+        hits++;
+        it->suspended = false;
+        it->unsavedFilesHash = unsavedFilesHash;
+        it->pins++;
+        entries.splice(entries.begin(), entries, it);
+        measure(*it);
+        enforceBudget();
+        return it->tu;
+      }
+    }
+    misses++;
+    CXTranslationUnit tu = nullptr;
+    parseTranslationUnitWithCaches(index, source_filename, command_line_args,
+                                   num_command_line_args, unsaved_files,
+                                   num_unsaved_files, options, &tu);
+    if (tu == nullptr) {
+      return nullptr;
+    }
+    entries.push_front({key, tu, 0, false, unsavedFilesHash, 1});
+    entriesByKey[key] = entries.begin();
+    measure(entries.front());
+    enforceBudget();
+    return tu;
+  }
+
+  // Unpins a translation unit returned by get(). Returns false if it is not
+  // pinned.
+  bool release(CXTranslationUnit tu) {
+    auto it = std::find_if(entries.begin(), entries.end(),
+                           [&](const Entry &entry) { return entry.tu == tu; });
+    if (it != entries.end()) {
+      if (it->pins == 0) {
+        return false;
+      }
+      it->pins--;
+      enforceBudget();
+      return true;
+    }
+    auto removed = uncachedPins.find(tu);
+    if (removed == uncachedPins.end()) {
+      return false;
+    }
+    if (--removed->second == 0) {
+      disposeTranslationUnit(tu);
+      uncachedPins.erase(removed);
+    }
+    return true;
+  }
+};
+
+// Creates an object holding a promise together with its resolve function.
+EM_JS(emscripten::EM_VAL, createDeferred, (), {
+  const deferred = {};
+  deferred.promise = new Promise(function(resolve) {
+    deferred.resolve = resolve;
+  });
+  return Emval.toHandle(deferred);
+});
+
+// Work which runs on a thread of the pool. JS values may only be touched on the
+// main thread, so everything run() needs is marshalled into the job (and its
+// arena) up front, and result() is called after control has returned to the
+// main thread. A job may be run on several threads at once, see
+// startAsyncJob.
+struct AsyncJob {
+  Arena arena;
+  emscripten::val deferred = emscripten::val::undefined();
+  std::atomic<unsigned> unfinishedRuns{0};
+
+  virtual ~AsyncJob() = default;
+  virtual void run() = 0;
+  virtual emscripten::val result() = 0;
+};
+
+// Asynchronous jobs are queued and run by a limited number of workers, so that
+// they never need more threads than the pool holds. libclang parses on a
+// thread of its own, so each worker takes two threads of the pool, and one
+// more is left for parses on the main thread. A thread beyond the pool would
+// wait for a new web worker, which only starts once the main thread yields.
+// Workers exit when the queue is empty.
+std::mutex asyncJobsMutex;
+std::deque<AsyncJob *> asyncJobQueue;
+unsigned asyncWorkers = 0;
+// Runs which are queued or running.
+unsigned activeAsyncRuns = 0;
+
+// The pool is created with one thread per logical core, see CMakeLists.txt.
+unsigned maxAsyncWorkers() {
+  static const unsigned max =
+      std::max(1, (emscripten_num_logical_cores() - 1) / 2);
+  return max;
+}
+
+// The number of runs which can start right away, at least 1.
+unsigned availableAsyncWorkers() {
+  std::lock_guard<std::mutex> lock(asyncJobsMutex);
+  return activeAsyncRuns < maxAsyncWorkers()
+             ? maxAsyncWorkers() - activeAsyncRuns
+             : 1;
+}
+
+void finishAsyncJob(AsyncJob *job) {
+  std::unique_ptr<AsyncJob> owned(job);
+  job->deferred["resolve"](job->result());
+}
+
+void runAsyncJobs() {
+  std::unique_lock<std::mutex> lock(asyncJobsMutex);
+  while (!asyncJobQueue.empty()) {
+    AsyncJob *job = asyncJobQueue.front();
+    asyncJobQueue.pop_front();
+    lock.unlock();
+    job->run();
+    if (--job->unfinishedRuns == 0) {
+      emscripten_async_run_in_main_runtime_thread(
+          EM_FUNC_SIG_VI, reinterpret_cast<void *>(&finishAsyncJob), job);
+    }
+    lock.lock();
+    activeAsyncRuns--;
+  }
+  asyncWorkers--;
+}
+
+// Queues runs calls of the job's run(), which may run concurrently, and
+// returns a promise which is resolved with the job's result after the last one
+// has returned.
+emscripten::val startAsyncJob(std::unique_ptr<AsyncJob> job,
+                              unsigned runs = 1) {
+  job->deferred = emscripten::val::take_ownership(createDeferred());
+  emscripten::val promise = job->deferred["promise"];
+  job->unfinishedRuns = runs;
+  std::lock_guard<std::mutex> lock(asyncJobsMutex);
+  asyncJobQueue.insert(asyncJobQueue.end(), runs, job.release());
+  activeAsyncRuns += runs;
+  for (unsigned i = 0; i < runs && asyncWorkers < maxAsyncWorkers(); i++) {
+    asyncWorkers++;
+    std::thread(runAsyncJobs).detach();
+  }
+  return promise;
+}
+
+// The arguments and the outcome of a single parse, marshalled into an arena.
+struct ParseRequest {
+  CXIndex index;
+  const char *sourceFilename = nullptr;
+  ConvertJSStringArrayResult commandLineArgs;
+  ConvertUnsavedFilesResult unsavedFiles;
+  unsigned options;
+  CXTranslationUnit tu = nullptr;
+  CXErrorCode errorCode = CXError_Failure;
+
+  ParseRequest(Arena &arena, CXIndex index, emscripten::val source_filename,
+               emscripten::val command_line_args, emscripten::val unsaved_files,
+               unsigned options)
+      : index(index), options(options) {
+    if (!source_filename.isNull() && !source_filename.isUndefined()) {
+      sourceFilename = arena.copyString(source_filename.as<std::string>());
+    }
+    commandLineArgs = convertJSStringArray(command_line_args, arena);
+    unsavedFiles = convertUnsavedFiles(unsaved_files, arena, true);
+  }
+
+  void run() {
+    errorCode = parseTranslationUnitWithCaches(
+        index, sourceFilename, commandLineArgs.stringArray,
+        commandLineArgs.length, unsavedFiles.unsavedFiles,
+        unsavedFiles.length, options, &tu);
+  }
+
+  emscripten::val result() const {
+    emscripten::val ret = emscripten::val::object();
+    ret.set("tu", Pointer({tu}));
+    ret.set("errorCode", static_cast<int>(errorCode));
+    return ret;
+  }
+};
+
+struct ParseJob : AsyncJob {
+  ParseRequest request;
+
+  ParseJob(CXIndex index, emscripten::val source_filename,
+           emscripten::val command_line_args, emscripten::val unsaved_files,
+           unsigned options)
+      : request(arena, index, source_filename, command_line_args,
+                unsaved_files, options) {}
+
+  void run() override { request.run(); }
+
+  emscripten::val result() override { return request.result(); }
+};
+
+// Parses many translation units. The job is run on several workers at once,
+// each of which claims the next unparsed request when it is done with its
+// previous one, so that a few expensive files do not hold up the rest.
+struct ParseManyJob : AsyncJob {
+  std::vector<ParseRequest> requests;
+  std::atomic<size_t> next{0};
+
+  ParseManyJob(CXIndex index, emscripten::val jobs, unsigned options) {
+    std::vector<emscripten::val> vjobs =
+        emscripten::vecFromJSArray<emscripten::val>(jobs);
+    requests.reserve(vjobs.size());
+    for (const emscripten::val &job : vjobs) {
+      requests.emplace_back(arena, index, job["file"], job["args"],
+                            job["unsavedFiles"], options);
+    }
+  }
+
+  void run() override {
+    for (size_t i = next++; i < requests.size(); i = next++) {
+      requests[i].run();
+    }
+  }
+
+  emscripten::val result() override {
+    emscripten::val ret = emscripten::val::array();
+    for (const ParseRequest &request : requests) {
+      ret.call<void>("push", request.result());
+    }
+    return ret;
+  }
 };
 
-ConvertJSStringArrayResult convertJSStringArray(emscripten::val v) {
-  std::vector<std::string> vs = emscripten::vecFromJSArray<std::string>(v);
-  const char **ret = new const char *[vs.size()]; // TODO: memory leak
-  for (int i = 0; i < vs.size(); i++) {
-    ret[i] = strdup(vs[i].c_str());
+struct ReparseJob : AsyncJob {
+  CXTranslationUnit tu;
+  ConvertUnsavedFilesResult unsavedFiles;
+  unsigned options;
+  int errorCode = CXError_Failure;
+
+  ReparseJob(CXTranslationUnit tu, emscripten::val unsaved_files,
+             unsigned options)
+      : tu(tu), options(options) {
+    unsavedFiles = convertUnsavedFiles(unsaved_files, arena, true);
+    addPendingJobs(tu, 1);
   }
-  return {ret, vs.size()};
+  ~ReparseJob() override { addPendingJobs(tu, -1); }
+
+  void run() override {
+    errorCode = clang_reparseTranslationUnit(
+        tu, unsavedFiles.length, unsavedFiles.unsavedFiles, options);
+  }
+
+  emscripten::val result() override { return emscripten::val(errorCode); }
+};
+
+// Plain C exports for hot loops, wrapped by raw.js as `raw`. They take and
+// return integers only: handles, and pointers to structs which the caller
+// places in scratch memory obtained from libclangjs_raw_malloc. Strings are
+// returned as pointers which stay valid until the next string is returned on
+// the same thread. CMakeLists.txt generates the list of functions for raw.js
+// from the EMSCRIPTEN_KEEPALIVE declarations below.
+thread_local std::string rawString;
+
+const char *toRawString(CXString str) {
+  const char *cstr = clang_getCString(str);
+  rawString = cstr == nullptr ? "" : cstr;
+  clang_disposeString(str);
+  return rawString.c_str();
 }
 
-std::vector<CXUnsavedFile> convertUnsavedFiles(emscripten::val f) {
-  std::vector<emscripten::val> vuf =
-      emscripten::vecFromJSArray<emscripten::val>(f);
-  std::vector<CXUnsavedFile> ret;
-  std::function<CXUnsavedFile(emscripten::val)> bla =
-      [](emscripten::val v) -> CXUnsavedFile {
-    return {strdup(v["filename"].as<std::string>().c_str()),
-            strdup(v["contents"].as<std::string>().c_str()),
-            v["contents"].as<std::string>().size()};
-  };
-  std::transform(vuf.begin(), vuf.end(), std::back_inserter(ret), bla);
-  return ret;
+extern "C" {
+
+EMSCRIPTEN_KEEPALIVE void *libclangjs_raw_malloc(size_t size) {
+  return malloc(size);
 }
 
-std::string cxStringToStdString(CXString str) {
-  std::string result = clang_getCString(str);
-  clang_disposeString(str);
-  return result;
+EMSCRIPTEN_KEEPALIVE void libclangjs_raw_free(void *ptr) { free(ptr); }
+
+EMSCRIPTEN_KEEPALIVE size_t libclangjs_raw_sizeofCursor() {
+  return sizeof(CXCursor);
+}
+
+EMSCRIPTEN_KEEPALIVE size_t libclangjs_raw_sizeofType() {
+  return sizeof(CXType);
+}
+
+EMSCRIPTEN_KEEPALIVE size_t libclangjs_raw_sizeofSourceLocation() {
+  return sizeof(CXSourceLocation);
+}
+
+EMSCRIPTEN_KEEPALIVE size_t libclangjs_raw_sizeofSourceRange() {
+  return sizeof(CXSourceRange);
+}
+
+EMSCRIPTEN_KEEPALIVE void
+libclangjs_raw_getTranslationUnitCursor(CXTranslationUnit tu, CXCursor *out) {
+  *out = clang_getTranslationUnitCursor(tu);
+}
+
+// Writes up to capacity children of parent to out and returns the number of
+// children.
+EMSCRIPTEN_KEEPALIVE unsigned libclangjs_raw_getChildren(const CXCursor *parent,
+                                                         CXCursor *out,
+                                                         unsigned capacity) {
+  struct Children {
+    CXCursor *out;
+    unsigned capacity;
+    unsigned count;
+  } children = {out, capacity, 0};
+  clang_visitChildren(
+      *parent,
+      [](CXCursor cursor, CXCursor, CXClientData client_data) {
+        auto *children = static_cast<Children *>(client_data);
+        if (children->count < children->capacity) {
+          children->out[children->count] = cursor;
+        }
+        children->count++;
+        return CXChildVisit_Continue;
+      },
+      &children);
+  return children.count;
+}
+
+EMSCRIPTEN_KEEPALIVE unsigned
+libclangjs_raw_getCursorKind(const CXCursor *cursor) {
+  return clang_getCursorKind(*cursor);
+}
+
+EMSCRIPTEN_KEEPALIVE unsigned
+libclangjs_raw_hashCursor(const CXCursor *cursor) {
+  return clang_hashCursor(*cursor);
+}
+
+EMSCRIPTEN_KEEPALIVE unsigned libclangjs_raw_equalCursors(const CXCursor *a,
+                                                          const CXCursor *b) {
+  return clang_equalCursors(*a, *b);
+}
+
+EMSCRIPTEN_KEEPALIVE int libclangjs_raw_Cursor_isNull(const CXCursor *cursor) {
+  return clang_Cursor_isNull(*cursor);
+}
+
+EMSCRIPTEN_KEEPALIVE unsigned libclangjs_raw_isDeclaration(unsigned kind) {
+  return clang_isDeclaration(static_cast<CXCursorKind>(kind));
+}
+
+EMSCRIPTEN_KEEPALIVE unsigned libclangjs_raw_isReference(unsigned kind) {
+  return clang_isReference(static_cast<CXCursorKind>(kind));
+}
+
+EMSCRIPTEN_KEEPALIVE unsigned libclangjs_raw_isExpression(unsigned kind) {
+  return clang_isExpression(static_cast<CXCursorKind>(kind));
+}
+
+EMSCRIPTEN_KEEPALIVE unsigned
+libclangjs_raw_getCursorLinkage(const CXCursor *cursor) {
+  return clang_getCursorLinkage(*cursor);
+}
+
+EMSCRIPTEN_KEEPALIVE int
+libclangjs_raw_Cursor_getNumArguments(const CXCursor *cursor) {
+  return clang_Cursor_getNumArguments(*cursor);
+}
+
+EMSCRIPTEN_KEEPALIVE void
+libclangjs_raw_Cursor_getArgument(const CXCursor *cursor, unsigned i,
+                                  CXCursor *out) {
+  *out = clang_Cursor_getArgument(*cursor, i);
+}
+
+EMSCRIPTEN_KEEPALIVE void
+libclangjs_raw_getCursorSemanticParent(const CXCursor *cursor, CXCursor *out) {
+  *out = clang_getCursorSemanticParent(*cursor);
+}
+
+EMSCRIPTEN_KEEPALIVE void
+libclangjs_raw_getCursorLexicalParent(const CXCursor *cursor, CXCursor *out) {
+  *out = clang_getCursorLexicalParent(*cursor);
+}
+
+EMSCRIPTEN_KEEPALIVE void
+libclangjs_raw_getCursorReferenced(const CXCursor *cursor, CXCursor *out) {
+  *out = clang_getCursorReferenced(*cursor);
+}
+
+EMSCRIPTEN_KEEPALIVE void
+libclangjs_raw_getCursorDefinition(const CXCursor *cursor, CXCursor *out) {
+  *out = clang_getCursorDefinition(*cursor);
+}
+
+EMSCRIPTEN_KEEPALIVE void
+libclangjs_raw_getCanonicalCursor(const CXCursor *cursor, CXCursor *out) {
+  *out = clang_getCanonicalCursor(*cursor);
+}
+
+EMSCRIPTEN_KEEPALIVE void
+libclangjs_raw_getCursorLocation(const CXCursor *cursor,
+                                 CXSourceLocation *out) {
+  *out = clang_getCursorLocation(*cursor);
+}
+
+EMSCRIPTEN_KEEPALIVE void
+libclangjs_raw_getCursorExtent(const CXCursor *cursor, CXSourceRange *out) {
+  *out = clang_getCursorExtent(*cursor);
+}
+
+EMSCRIPTEN_KEEPALIVE void libclangjs_raw_getCursorType(const CXCursor *cursor,
+                                                       CXType *out) {
+  *out = clang_getCursorType(*cursor);
+}
+
+EMSCRIPTEN_KEEPALIVE void
+libclangjs_raw_getCursorResultType(const CXCursor *cursor, CXType *out) {
+  *out = clang_getCursorResultType(*cursor);
+}
+
+EMSCRIPTEN_KEEPALIVE void
+libclangjs_raw_getTypedefDeclUnderlyingType(const CXCursor *cursor,
+                                            CXType *out) {
+  *out = clang_getTypedefDeclUnderlyingType(*cursor);
+}
+
+EMSCRIPTEN_KEEPALIVE const char *
+libclangjs_raw_getCursorSpelling(const CXCursor *cursor) {
+  return toRawString(clang_getCursorSpelling(*cursor));
+}
+
+EMSCRIPTEN_KEEPALIVE const char *
+libclangjs_raw_getCursorDisplayName(const CXCursor *cursor) {
+  return toRawString(clang_getCursorDisplayName(*cursor));
+}
+
+EMSCRIPTEN_KEEPALIVE const char *
+libclangjs_raw_getCursorUSR(const CXCursor *cursor) {
+  return toRawString(clang_getCursorUSR(*cursor));
+}
+
+EMSCRIPTEN_KEEPALIVE unsigned libclangjs_raw_getTypeKind(const CXType *type) {
+  return type->kind;
+}
+
+EMSCRIPTEN_KEEPALIVE const char *
+libclangjs_raw_getTypeSpelling(const CXType *type) {
+  return toRawString(clang_getTypeSpelling(*type));
+}
+
+EMSCRIPTEN_KEEPALIVE unsigned libclangjs_raw_equalTypes(const CXType *a,
+                                                        const CXType *b) {
+  return clang_equalTypes(*a, *b);
+}
+
+EMSCRIPTEN_KEEPALIVE int libclangjs_raw_getNumArgTypes(const CXType *type) {
+  return clang_getNumArgTypes(*type);
+}
+
+EMSCRIPTEN_KEEPALIVE void libclangjs_raw_getArgType(const CXType *type,
+                                                    unsigned i, CXType *out) {
+  *out = clang_getArgType(*type, i);
+}
+
+EMSCRIPTEN_KEEPALIVE void libclangjs_raw_getCanonicalType(const CXType *type,
+                                                          CXType *out) {
+  *out = clang_getCanonicalType(*type);
+}
+
+EMSCRIPTEN_KEEPALIVE void libclangjs_raw_getPointeeType(const CXType *type,
+                                                        CXType *out) {
+  *out = clang_getPointeeType(*type);
+}
+
+EMSCRIPTEN_KEEPALIVE void libclangjs_raw_getResultType(const CXType *type,
+                                                       CXType *out) {
+  *out = clang_getResultType(*type);
+}
+
+EMSCRIPTEN_KEEPALIVE void libclangjs_raw_getTypeDeclaration(const CXType *type,
+                                                            CXCursor *out) {
+  *out = clang_getTypeDeclaration(*type);
+}
+
+EMSCRIPTEN_KEEPALIVE unsigned
+libclangjs_raw_equalRanges(const CXSourceRange *a, const CXSourceRange *b) {
+  return clang_equalRanges(*a, *b);
+}
+
+EMSCRIPTEN_KEEPALIVE void
+libclangjs_raw_getRangeStart(const CXSourceRange *range,
+                             CXSourceLocation *out) {
+  *out = clang_getRangeStart(*range);
+}
+
+EMSCRIPTEN_KEEPALIVE void
+libclangjs_raw_getRangeEnd(const CXSourceRange *range, CXSourceLocation *out) {
+  *out = clang_getRangeEnd(*range);
+}
+
+EMSCRIPTEN_KEEPALIVE unsigned
+libclangjs_raw_equalLocations(const CXSourceLocation *a,
+                              const CXSourceLocation *b) {
+  return clang_equalLocations(*a, *b);
+}
+
+EMSCRIPTEN_KEEPALIVE int
+libclangjs_raw_Location_isFromMainFile(const CXSourceLocation *location) {
+  return clang_Location_isFromMainFile(*location);
+}
+
+// Writes the line and column to out and returns the file name.
+EMSCRIPTEN_KEEPALIVE const char *
+libclangjs_raw_getPresumedLocation(const CXSourceLocation *location,
+                                   uint32_t *out) {
+  CXString fileName;
+  clang_getPresumedLocation(*location, &fileName, &out[0], &out[1]);
+  return toRawString(fileName);
+}
+
+// Location getters write the file handle, line, column and offset to out.
+EMSCRIPTEN_KEEPALIVE void
+libclangjs_raw_getSpellingLocation(const CXSourceLocation *location,
+                                   uint32_t *out) {
+  CXFile file;
+  clang_getSpellingLocation(*location, &file, &out[1], &out[2], &out[3]);
+  out[0] = reinterpret_cast<uintptr_t>(file);
+}
+
+EMSCRIPTEN_KEEPALIVE void
+libclangjs_raw_getExpansionLocation(const CXSourceLocation *location,
+                                    uint32_t *out) {
+  CXFile file;
+  clang_getExpansionLocation(*location, &file, &out[1], &out[2], &out[3]);
+  out[0] = reinterpret_cast<uintptr_t>(file);
+}
+
+EMSCRIPTEN_KEEPALIVE void
+libclangjs_raw_getFileLocation(const CXSourceLocation *location,
+                               uint32_t *out) {
+  CXFile file;
+  clang_getFileLocation(*location, &file, &out[1], &out[2], &out[3]);
+  out[0] = reinterpret_cast<uintptr_t>(file);
+}
+
+EMSCRIPTEN_KEEPALIVE const char *libclangjs_raw_getFileName(CXFile file) {
+  return toRawString(clang_getFileName(file));
 }
 
-emscripten::val cxStringToStdStringOrNull(CXString str) {
-  if (clang_getCString(str) == nullptr) {
-    return emscripten::val::null();
-  } else {
-    return emscripten::val(cxStringToStdString(str));
-  }
 }
 
 EMSCRIPTEN_BINDINGS(libclagjs) {
@@ -66,6 +2491,20 @@ EMSCRIPTEN_BINDINGS(libclagjs) {
           }));
   emscripten::function("disposeIndex",
                        emscripten::optional_override([](Pointer &index) {
+                         {
+                           std::lock_guard<std::mutex> lock(indexSettingsMutex);
+                           indexSettings.erase(index.ptr);
+                         }
+                         {
+                           std::lock_guard<std::mutex> lock(
+                               liveTranslationUnitsMutex);
+                           for (auto it = liveTranslationUnits.begin();
+                                it != liveTranslationUnits.end();) {
+                             it = it->second.index == index.ptr
+                                      ? liveTranslationUnits.erase(it)
+                                      : std::next(it);
+                           }
+                         }
                          return clang_disposeIndex(index.ptr);
                        }));
   emscripten::enum_<CXGlobalOptFlags>("CXGlobalOptFlags")
@@ -92,6 +2531,27 @@ EMSCRIPTEN_BINDINGS(libclagjs) {
             index.ptr,
             path.isNull() ? nullptr : path.as<std::string>().c_str());
       }));
+  emscripten::function(
+      "CXIndex_setPreambleCacheDirectory",
+      emscripten::optional_override([](Pointer &index, emscripten::val path) {
+        std::lock_guard<std::mutex> lock(indexSettingsMutex);
+        indexSettings[index.ptr].preambleCacheDirectory =
+            path.isNull() || path.isUndefined() ? "" : path.as<std::string>();
+      }));
+  emscripten::function(
+      "CXIndex_setPchBundle",
+      emscripten::optional_override([](Pointer &index,
+                                       emscripten::val manifestPath) {
+        std::vector<PchBundle> bundles;
+        if (!manifestPath.isNull() && !manifestPath.isUndefined()) {
+          if (!loadPchBundles(manifestPath.as<std::string>(), bundles)) {
+            return false;
+          }
+        }
+        std::lock_guard<std::mutex> lock(indexSettingsMutex);
+        indexSettings[index.ptr].pchBundles = std::move(bundles);
+        return true;
+      }));
   emscripten::function(
       "getFileName", emscripten::optional_override([](Pointer &SFile) {
         return cxStringToStdString(clang_getFileName(SFile.ptr));
@@ -133,11 +2593,12 @@ EMSCRIPTEN_BINDINGS(libclagjs) {
                          return cxStringToStdString(
                              clang_File_tryGetRealPathName(file.ptr));
                        }));
-  emscripten::class_<CXSourceLocation>("CXSourceLocation")
-      .property("int_data", &CXSourceLocation::int_data);
-  emscripten::class_<CXSourceRange>("CXSourceRange")
-      .property("begin_int_data", &CXSourceRange::begin_int_data)
-      .property("end_int_data", &CXSourceRange::end_int_data);
+  static_assert(sizeof(CXSourceLocation) == 3 * sizeof(uint32_t));
+  registerStruct<CXSourceLocation>("CXSourceLocation",
+                                   "ptr_data0,ptr_data1,int_data");
+  static_assert(sizeof(CXSourceRange) == 4 * sizeof(uint32_t));
+  registerStruct<CXSourceRange>(
+      "CXSourceRange", "ptr_data0,ptr_data1,begin_int_data,end_int_data");
   emscripten::function("getNullLocation", &clang_getNullLocation);
   emscripten::function("equalLocations", &clang_equalLocations);
   emscripten::function(
@@ -262,16 +2723,35 @@ EMSCRIPTEN_BINDINGS(libclagjs) {
                        emscripten::optional_override([](Pointer &D) {
                          return Pointer({clang_getChildDiagnostics(D.ptr)});
                        }));
-  // skipped clang_getNumDiagnostics
-  // skipped clang_getDiagnostic
+  emscripten::function("getNumDiagnostics",
+                       emscripten::optional_override([](Pointer &Unit) {
+                         return clang_getNumDiagnostics(
+                             static_cast<CXTranslationUnit>(Unit.ptr));
+                       }));
+  emscripten::function(
+      "getDiagnostic",
+      emscripten::optional_override([](Pointer &Unit, unsigned Index) {
+        return Pointer({clang_getDiagnostic(
+            static_cast<CXTranslationUnit>(Unit.ptr), Index)});
+      }));
   // skipped clang_getDiagnosticSetFromTU
-  // skipped clang_disposeDiagnostic
+  emscripten::function("disposeDiagnostic",
+                       emscripten::optional_override([](Pointer &Diagnostic) {
+                         return clang_disposeDiagnostic(Diagnostic.ptr);
+                       }));
   // skipped CXDiagnosticDisplayOptions
   // skipped clang_formatDiagnostic
   // skipped clang_defaultDiagnosticDisplayOptions
-  // skipped clang_getDiagnosticSeverity
+  emscripten::function("getDiagnosticSeverity",
+                       emscripten::optional_override([](Pointer &Diagnostic) {
+                         return clang_getDiagnosticSeverity(Diagnostic.ptr);
+                       }));
   // skipped clang_getDiagnosticLocation
-  // skipped clang_getDiagnosticSpelling
+  emscripten::function("getDiagnosticSpelling",
+                       emscripten::optional_override([](Pointer &Diagnostic) {
+                         return cxStringToStdString(
+                             clang_getDiagnosticSpelling(Diagnostic.ptr));
+                       }));
   // skipped clang_getDiagnosticOption
   // skipped clang_getDiagnosticCategory
   // skipped clang_getDiagnosticCategoryName
@@ -291,33 +2771,33 @@ EMSCRIPTEN_BINDINGS(libclagjs) {
       emscripten::optional_override(
           [](Pointer CIdx, emscripten::val source_filename,
              emscripten::val command_line_args, emscripten::val unsaved_files) {
+            Arena arena;
             auto [convertedCommandLineArgs, numConvertedCommandLineArgs] =
-                (command_line_args.isNull() || command_line_args.isUndefined())
-                    ? ConvertJSStringArrayResult({nullptr, 0})
-                    : convertJSStringArray(command_line_args);
-            unsigned numConvertedUnsavedFiles = 0;
-            CXUnsavedFile *convertedUnsavedFiles = nullptr;
-            if (!(unsaved_files.isNull() || unsaved_files.isUndefined())) {
-              auto f = convertUnsavedFiles(unsaved_files);
-              numConvertedUnsavedFiles = f.size();
-              convertedUnsavedFiles = &f[0];
-            }
-            return Pointer({clang_createTranslationUnitFromSourceFile(
+                convertJSStringArray(command_line_args, arena);
+            auto [convertedUnsavedFiles, numConvertedUnsavedFiles] =
+                convertUnsavedFiles(unsaved_files, arena);
+            return Pointer({registerTranslationUnit(
                 CIdx.ptr,
-                (source_filename.isNull() || source_filename.isUndefined())
-                    ? nullptr
-                    : source_filename.as<std::string>().c_str(),
-                numConvertedCommandLineArgs, convertedCommandLineArgs,
-                numConvertedUnsavedFiles, convertedUnsavedFiles)});
+                clang_createTranslationUnitFromSourceFile(
+                    CIdx.ptr,
+                    (source_filename.isNull() || source_filename.isUndefined())
+                        ? nullptr
+                        : source_filename.as<std::string>().c_str(),
+                    numConvertedCommandLineArgs, convertedCommandLineArgs,
+                    numConvertedUnsavedFiles, convertedUnsavedFiles))});
           }));
   emscripten::function(
       "createTranslationUnit",
       emscripten::optional_override(
           [](Pointer CIdx, emscripten::val ast_filename) {
-            return Pointer({clang_createTranslationUnit(
-                CIdx.ptr, ast_filename.isNull()
-                              ? nullptr
-                              : ast_filename.as<std::string>().c_str())});
+            std::string filename = ast_filename.isNull()
+                                       ? ""
+                                       : ast_filename.as<std::string>();
+            return Pointer({registerTranslationUnit(
+                CIdx.ptr, clang_createTranslationUnit(
+                              CIdx.ptr, ast_filename.isNull()
+                                            ? nullptr
+                                            : filename.c_str()))});
           }));
   // skipped clang_createTranslationUnit2
   emscripten::enum_<CXTranslationUnit_Flags>("CXTranslationUnit_Flags")
@@ -353,27 +2833,59 @@ EMSCRIPTEN_BINDINGS(libclagjs) {
           [](Pointer CIdx, emscripten::val source_filename,
              emscripten::val command_line_args, emscripten::val unsaved_files,
              unsigned options) {
+            Arena arena;
             auto [convertedCommandLineArgs, numConvertedCommandLineArgs] =
-                (command_line_args.isNull() || command_line_args.isUndefined())
-                    ? ConvertJSStringArrayResult({nullptr, 0})
-                    : convertJSStringArray(command_line_args);
-            unsigned numConvertedUnsavedFiles = 0;
-            CXUnsavedFile *convertedUnsavedFiles = nullptr;
-            if (unsaved_files.isNull() || unsaved_files.isUndefined()) {
-              unsaved_files = emscripten::val::array();
-            }
-            auto f = convertUnsavedFiles(unsaved_files);
-            numConvertedUnsavedFiles = f.size();
-            convertedUnsavedFiles =
-                numConvertedUnsavedFiles > 0 ? &f[0] : nullptr;
-            return Pointer({clang_parseTranslationUnit(
+                convertJSStringArray(command_line_args, arena);
+            auto [convertedUnsavedFiles, numConvertedUnsavedFiles] =
+                convertUnsavedFiles(unsaved_files, arena);
+            CXTranslationUnit tu = nullptr;
+            parseTranslationUnitWithCaches(
                 CIdx.ptr,
                 (source_filename.isNull() || source_filename.isUndefined())
                     ? nullptr
                     : source_filename.as<std::string>().c_str(),
                 convertedCommandLineArgs, numConvertedCommandLineArgs,
-                convertedUnsavedFiles, numConvertedUnsavedFiles, options)});
+                convertedUnsavedFiles, numConvertedUnsavedFiles, options, &tu);
+            return Pointer({tu});
+          }));
+  emscripten::enum_<CXErrorCode>("CXErrorCode")
+      .value("Success", CXError_Success)
+      .value("Failure", CXError_Failure)
+      .value("Crashed", CXError_Crashed)
+      .value("InvalidArguments", CXError_InvalidArguments)
+      .value("ASTReadError", CXError_ASTReadError);
+  emscripten::function(
+      "parseTranslationUnitAsync",
+      emscripten::optional_override(
+          [](Pointer CIdx, emscripten::val source_filename,
+             emscripten::val command_line_args, emscripten::val unsaved_files,
+             unsigned options) {
+            return startAsyncJob(std::make_unique<ParseJob>(
+                CIdx.ptr, source_filename, command_line_args, unsaved_files,
+                options));
           }));
+  emscripten::function(
+      "parseMany",
+      emscripten::optional_override([](Pointer CIdx, emscripten::val jobs,
+                                       emscripten::val options) {
+        unsigned parseOptions = 0;
+        // Workers busy with other jobs are not available.
+        unsigned threads = availableAsyncWorkers();
+        if (!options.isNull() && !options.isUndefined()) {
+          if (!options["options"].isUndefined()) {
+            parseOptions = options["options"].as<unsigned>();
+          }
+          if (!options["threads"].isUndefined()) {
+            threads = std::clamp(options["threads"].as<unsigned>(), 1u,
+                                 threads);
+          }
+        }
+        auto job =
+            std::make_unique<ParseManyJob>(CIdx.ptr, jobs, parseOptions);
+        unsigned runs = std::max<size_t>(
+            1, std::min<size_t>(threads, job->requests.size()));
+        return startAsyncJob(std::move(job), runs);
+      }));
   // skipped clang_parseTranslationUnit2
   // skipped clang_parseTranslationUnit2FullArgv
   emscripten::enum_<CXSaveTranslationUnit_Flags>("CXSaveTranslationUnit_Flags")
@@ -391,17 +2903,20 @@ EMSCRIPTEN_BINDINGS(libclagjs) {
       "saveTranslationUnit",
       emscripten::optional_override([](Pointer TU, std::string FileName,
                                        unsigned options) {
-        return clang_saveTranslationUnit(static_cast<CXTranslationUnit>(TU.ptr),
-                                         FileName.c_str(), options);
+        auto tu = static_cast<CXTranslationUnit>(TU.ptr);
+        if (hasPendingJobs(tu)) {
+          return static_cast<int>(CXSaveError_InvalidTU);
+        }
+        return clang_saveTranslationUnit(tu, FileName.c_str(), options);
+      }));
+  emscripten::function(
+      "suspendTranslationUnit", emscripten::optional_override([](Pointer TU) {
+        auto tu = static_cast<CXTranslationUnit>(TU.ptr);
+        return hasPendingJobs(tu) ? 0u : clang_suspendTranslationUnit(tu);
       }));
-  emscripten::function("suspendTranslationUnit",
-                       emscripten::optional_override([](Pointer TU) {
-                         return clang_suspendTranslationUnit(
-                             static_cast<CXTranslationUnit>(TU.ptr));
-                       }));
   emscripten::function("disposeTranslationUnit",
                        emscripten::optional_override([](Pointer TU) {
-                         return clang_disposeTranslationUnit(
+                         return disposeTranslationUnit(
                              static_cast<CXTranslationUnit>(TU.ptr));
                        }));
   emscripten::enum_<CXReparse_Flags>("CXReparse_Flags")
@@ -415,18 +2930,129 @@ EMSCRIPTEN_BINDINGS(libclagjs) {
       "reparseTranslationUnit",
       emscripten::optional_override(
           [](Pointer TU, emscripten::val unsaved_files, unsigned options) {
-            unsigned numConvertedUnsavedFiles = 0;
-            CXUnsavedFile *convertedUnsavedFiles = nullptr;
-            if (unsaved_files.isNull() || unsaved_files.isUndefined()) {
-              unsaved_files = emscripten::val::array();
+            auto tu = static_cast<CXTranslationUnit>(TU.ptr);
+            if (hasPendingJobs(tu)) {
+              return static_cast<int>(CXError_InvalidArguments);
             }
-            auto f = convertUnsavedFiles(unsaved_files);
-            numConvertedUnsavedFiles = f.size();
-            convertedUnsavedFiles =
-                numConvertedUnsavedFiles > 0 ? &f[0] : nullptr;
-            return clang_reparseTranslationUnit(
-                static_cast<CXTranslationUnit>(TU.ptr),
-                numConvertedUnsavedFiles, convertedUnsavedFiles, options);
+            Arena arena;
+            auto [convertedUnsavedFiles, numConvertedUnsavedFiles] =
+                convertUnsavedFiles(unsaved_files, arena);
+            return clang_reparseTranslationUnit(tu, numConvertedUnsavedFiles,
+                                                convertedUnsavedFiles, options);
+          }));
+  emscripten::function(
+      "reparseTranslationUnitAsync",
+      emscripten::optional_override(
+          [](Pointer TU, emscripten::val unsaved_files, unsigned options) {
+            auto tu = static_cast<CXTranslationUnit>(TU.ptr);
+            if (hasPendingJobs(tu)) {
+              return emscripten::val::global("Promise").call<emscripten::val>(
+                  "resolve", static_cast<int>(CXError_InvalidArguments));
+            }
+            return startAsyncJob(
+                std::make_unique<ReparseJob>(tu, unsaved_files, options));
+          }));
+  emscripten::function(
+      "createTranslationUnitCache",
+      emscripten::optional_override([](Pointer CIdx, double budget) {
+        return Pointer({new TranslationUnitCache(
+            CIdx.ptr, budget >= static_cast<double>(SIZE_MAX)
+                          ? SIZE_MAX
+                          : static_cast<size_t>(std::max(0.0, budget)))});
+      }));
+  emscripten::function("disposeTranslationUnitCache",
+                       emscripten::optional_override([](Pointer cache) {
+                         delete static_cast<TranslationUnitCache *>(cache.ptr);
+                       }));
+  emscripten::function(
+      "TranslationUnitCache_get",
+      emscripten::optional_override(
+          [](Pointer cache, std::string source_filename,
+             emscripten::val command_line_args, emscripten::val unsaved_files,
+             unsigned options) {
+            Arena arena;
+            auto [convertedCommandLineArgs, numConvertedCommandLineArgs] =
+                convertJSStringArray(command_line_args, arena);
+            auto [convertedUnsavedFiles, numConvertedUnsavedFiles] =
+                convertUnsavedFiles(unsaved_files, arena);
+            return Pointer({static_cast<TranslationUnitCache *>(cache.ptr)->get(
+                source_filename.c_str(), convertedCommandLineArgs,
+                numConvertedCommandLineArgs, convertedUnsavedFiles,
+                numConvertedUnsavedFiles, options)});
+          }));
+  emscripten::function(
+      "TranslationUnitCache_release",
+      emscripten::optional_override([](Pointer cache, Pointer TU) {
+        return static_cast<TranslationUnitCache *>(cache.ptr)->release(
+            static_cast<CXTranslationUnit>(TU.ptr));
+      }));
+  emscripten::function(
+      "TranslationUnitCache_getStats",
+      emscripten::optional_override([](Pointer cache) {
+        const auto *c = static_cast<TranslationUnitCache *>(cache.ptr);
+        emscripten::val ret = emscripten::val::object();
+        ret.set("entries", c->entries.size());
+        ret.set("suspendedEntries",
+                std::count_if(c->entries.begin(), c->entries.end(),
+                              [](const TranslationUnitCache::Entry &entry) {
+                                return entry.suspended;
+                              }));
+        ret.set("pinnedEntries",
+                std::count_if(c->entries.begin(), c->entries.end(),
+                              [](const TranslationUnitCache::Entry &entry) {
+                                return entry.pins > 0;
+                              }));
+        ret.set("bytes", c->bytes);
+        ret.set("budget", static_cast<double>(c->budget));
+        ret.set("hits", c->hits);
+        ret.set("misses", c->misses);
+        ret.set("suspensions", c->suspensions);
+        ret.set("evictions", c->evictions);
+        return ret;
+      }));
+  emscripten::function("createUnsavedFileStore",
+                       emscripten::optional_override([]() {
+                         return UnsavedFileStoreHandle{new UnsavedFileStore()};
+                       }));
+  emscripten::function(
+      "disposeUnsavedFileStore",
+      emscripten::optional_override(
+          [](UnsavedFileStoreHandle store) { delete store.ptr; }));
+  emscripten::function(
+      "UnsavedFileStore_setContents",
+      emscripten::optional_override([](UnsavedFileStoreHandle store,
+                                       std::string filename,
+                                       emscripten::val contents) {
+        store.ptr->files[filename] = convertUnsavedFileContents(contents);
+      }));
+  emscripten::function(
+      "UnsavedFileStore_applyEdit",
+      emscripten::optional_override(
+          [](UnsavedFileStoreHandle store, std::string filename,
+             unsigned offset, unsigned deleteLength, std::string insertText) {
+            auto &files = store.ptr->files;
+            auto it = files.find(filename);
+            if (it == files.end() || offset > it->second.size() ||
+                deleteLength > it->second.size() - offset) {
+              return false;
+            }
+            it->second.replace(offset, deleteLength, insertText);
+            return true;
+          }));
+  emscripten::function(
+      "UnsavedFileStore_remove",
+      emscripten::optional_override(
+          [](UnsavedFileStoreHandle store, std::string filename) {
+            return store.ptr->files.erase(filename) > 0;
+          }));
+  emscripten::function(
+      "UnsavedFileStore_getContents",
+      emscripten::optional_override(
+          [](UnsavedFileStoreHandle store, std::string filename) {
+            const auto &files = store.ptr->files;
+            auto it = files.find(filename);
+            return it == files.end() ? emscripten::val::null()
+                                     : emscripten::val(it->second);
           }));
   emscripten::enum_<CXTUResourceUsageKind>("CXTUResourceUsageKind")
       .value("AST", CXTUResourceUsage_AST)
@@ -461,10 +3087,37 @@ EMSCRIPTEN_BINDINGS(libclagjs) {
         const char *ret = clang_getTUResourceUsageName(kind);
         return ret == nullptr ? nullptr : std::string(ret);
       }));
-  // skipped CXTUResourceUsageEntry
-  // skipped CXTUResourceUsage
-  // skipped clang_getCXTUResourceUsage
-  // skipped clang_disposeCXTUResourceUsage
+  emscripten::function(
+      "getTUResourceUsage", emscripten::optional_override([](Pointer TU) {
+        std::map<CXTUResourceUsageKind, double> bytesByKind;
+        auto tu = static_cast<CXTranslationUnit>(TU.ptr);
+        if (!hasPendingJobs(tu)) {
+          addTUResourceUsage(tu, bytesByKind);
+        }
+        return encodeTUResourceUsage(bytesByKind);
+      }));
+  emscripten::function(
+      "getIndexResourceUsage", emscripten::optional_override([](Pointer CIdx) {
+        std::map<CXTUResourceUsageKind, double> bytesByKind;
+        unsigned translationUnits = 0;
+        unsigned busyTranslationUnits = 0;
+        std::lock_guard<std::mutex> lock(liveTranslationUnitsMutex);
+        for (const auto &[tu, live] : liveTranslationUnits) {
+          if (live.index != CIdx.ptr) {
+            continue;
+          }
+          if (live.pendingJobs > 0) {
+            busyTranslationUnits++;
+          } else {
+            addTUResourceUsage(tu, bytesByKind);
+            translationUnits++;
+          }
+        }
+        emscripten::val ret = encodeTUResourceUsage(bytesByKind);
+        ret.set("translationUnits", translationUnits);
+        ret.set("busyTranslationUnits", busyTranslationUnits);
+        return ret;
+      }));
   // skipped clang_getTranslationUnitTargetInfo
   // skipped clang_TargetInfo_dispose
   // skipped clang_TargetInfo_getTriple
@@ -763,9 +3416,10 @@ EMSCRIPTEN_BINDINGS(libclagjs) {
       .value("FirstExtraDecl", CXCursor_FirstExtraDecl)
       .value("LastExtraDecl", CXCursor_LastExtraDecl)
       .value("OverloadCandidate", CXCursor_OverloadCandidate);
-  emscripten::class_<CXCursor>("CXCursor")
-      .property("kind", &CXCursor::kind)
-      .property("xdata", &CXCursor::xdata);
+  static_assert(sizeof(CXCursor) == 5 * sizeof(uint32_t));
+  // xdata is signed.
+  registerStruct<CXCursor>("CXCursor", "kind,xdata,data0,data1,data2",
+                           "CXCursorKind", 1 << 1);
   emscripten::function("getNullCursor", &clang_getNullCursor);
   emscripten::function("getTranslationUnitCursor",
                        emscripten::optional_override([](Pointer &p) {
@@ -1002,7 +3656,8 @@ EMSCRIPTEN_BINDINGS(libclagjs) {
       .value("SwiftAsync", CXCallingConv_SwiftAsync)
       .value("Invalid", CXCallingConv_Invalid)
       .value("Unexposed", CXCallingConv_Unexposed);
-  emscripten::class_<CXType>("CXType").property("kind", &CXType::kind);
+  static_assert(sizeof(CXType) == 3 * sizeof(uint32_t));
+  registerStruct<CXType>("CXType", "kind,data0,data1", "CXTypeKind");
   emscripten::function("getCursorType", &clang_getCursorType);
   emscripten::function("getTypeSpelling",
                        emscripten::optional_override([](CXType CT) {
@@ -1168,12 +3823,11 @@ EMSCRIPTEN_BINDINGS(libclagjs) {
       .value("Recurse", CXChildVisit_Recurse);
   emscripten::function(
       "visitChildren",
-      emscripten::optional_override([](CXCursor &parent,
+      emscripten::optional_override([](CXCursor parent,
                                        emscripten::val visitor) {
-        typedef std::function<CXChildVisitResult(CXCursor &, CXCursor &)>
-            Callback;
-        Callback callback = [&visitor](CXCursor &cursor,
-                                       CXCursor &parent) -> CXChildVisitResult {
+        typedef std::function<CXChildVisitResult(CXCursor, CXCursor)> Callback;
+        Callback callback = [&visitor](CXCursor cursor,
+                                       CXCursor parent) -> CXChildVisitResult {
           return static_cast<CXChildVisitResult>(
               visitor(cursor, parent)["value"].as<int>());
         };
@@ -1186,6 +3840,49 @@ EMSCRIPTEN_BINDINGS(libclagjs) {
             &callback);
       }));
   // skipped clang_visitChildrenWithBlock
+  emscripten::function(
+      "visitChildrenFiltered",
+      emscripten::optional_override([](CXCursor parent, emscripten::val filter,
+                                       emscripten::val visitor) {
+        CursorFilter cursorFilter = convertCursorFilter(filter);
+        bool broken = false;
+        walkCursorTree(parent, [&](CXCursor cursor, CXCursor cursorParent,
+                                   unsigned depth) {
+          if (cursorFilter.prunesSubtree(cursor)) {
+            return CXChildVisit_Continue;
+          }
+          CXChildVisitResult result = CXChildVisit_Recurse;
+          if (cursorFilter.matchesKind(clang_getCursorKind(cursor))) {
+            result = static_cast<CXChildVisitResult>(
+                visitor(cursor, cursorParent)["value"].as<int>());
+            if (result == CXChildVisit_Break) {
+              broken = true;
+              return CXChildVisit_Break;
+            }
+          }
+          if (cursorFilter.maxDepth != 0 && depth >= cursorFilter.maxDepth) {
+            return CXChildVisit_Continue;
+          }
+          return result;
+        });
+        return broken ? 1u : 0u;
+      }));
+  emscripten::function(
+      "visitChildrenBatched",
+      emscripten::optional_override([](CXCursor parent, emscripten::val visitor,
+                                       emscripten::val batchSize) {
+        return visitChildrenBatched(parent, visitor,
+                                    convertBatchSize(batchSize));
+      }));
+  emscripten::enum_<CursorTreeField>("CursorTreeField")
+      .value("Kind", CursorTreeField_Kind)
+      .value("Parent", CursorTreeField_Parent)
+      .value("Depth", CursorTreeField_Depth)
+      .value("File", CursorTreeField_File)
+      .value("Offsets", CursorTreeField_Offsets)
+      .value("Spelling", CursorTreeField_Spelling)
+      .value("All", CursorTreeField_All);
+  emscripten::function("exportCursorTree", &exportCursorTree);
   emscripten::function("getCursorUSR",
                        emscripten::optional_override([](CXCursor C) {
                          return cxStringToStdString(clang_getCursorUSR(C));
@@ -1454,6 +4151,13 @@ EMSCRIPTEN_BINDINGS(libclagjs) {
   // skipped clang_tokenize
   // skipped clang_annotateTokens
   // skipped clang_disposeTokens
+  emscripten::function(
+      "tokenizeRange", emscripten::optional_override([](Pointer TU,
+                                                        CXSourceRange Range,
+                                                        bool annotate) {
+        return tokenizeRange(static_cast<CXTranslationUnit>(TU.ptr), Range,
+                             annotate);
+      }));
   emscripten::function("getCursorKindSpelling",
                        emscripten::optional_override([](CXCursorKind Kind) {
                          return cxStringToStdString(
@@ -1501,10 +4205,76 @@ EMSCRIPTEN_BINDINGS(libclagjs) {
   // skipped CXCodeCompleteResults
   // skipped clang_getCompletionNumFixIts
   // skipped clang_getCompletionFixIt
-  // skipped CXCodeComplete_Flags
+  emscripten::enum_<CXCodeComplete_Flags>("CXCodeComplete_Flags")
+      .value("IncludeMacros", CXCodeComplete_IncludeMacros)
+      .value("IncludeCodePatterns", CXCodeComplete_IncludeCodePatterns)
+      .value("IncludeBriefComments", CXCodeComplete_IncludeBriefComments)
+      .value("SkipPreamble", CXCodeComplete_SkipPreamble)
+      .value("IncludeCompletionsWithFixIts",
+             CXCodeComplete_IncludeCompletionsWithFixIts);
   // skipped CXCompletionContext
-  // skipped clang_defaultCodeCompleteOptions
-  // skipped clang_codeCompleteAt
+  emscripten::function("defaultCodeCompleteOptions",
+                       &clang_defaultCodeCompleteOptions);
+  emscripten::function(
+      "codeCompleteAt",
+      emscripten::optional_override(
+          [](Pointer TU, std::string complete_filename, unsigned complete_line,
+             unsigned complete_column, emscripten::val unsaved_files,
+             unsigned options, std::string prefix, unsigned limit) {
+            Arena arena;
+            auto [convertedUnsavedFiles, numConvertedUnsavedFiles] =
+                convertUnsavedFiles(unsaved_files, arena);
+            CXCodeCompleteResults *results = clang_codeCompleteAt(
+                static_cast<CXTranslationUnit>(TU.ptr),
+                complete_filename.c_str(), complete_line, complete_column,
+                convertedUnsavedFiles, numConvertedUnsavedFiles, options);
+            std::vector<CompletionCandidate> candidates =
+                collectCompletionCandidates(results);
+            size_t matches = 0;
+            std::vector<const CompletionCandidate *> completions =
+                selectCompletions(candidates, prefix, limit, matches);
+            emscripten::val ret = encodeCompletions(completions, matches);
+            if (results != nullptr) {
+              clang_disposeCodeCompleteResults(results);
+            }
+            return ret;
+          }));
+  emscripten::function(
+      "createCodeCompletionSession",
+      emscripten::optional_override(
+          [](Pointer TU, std::string complete_filename, unsigned complete_line,
+             unsigned complete_column, emscripten::val unsaved_files,
+             unsigned options) {
+            Arena arena;
+            auto [convertedUnsavedFiles, numConvertedUnsavedFiles] =
+                convertUnsavedFiles(unsaved_files, arena);
+            CXCodeCompleteResults *results = clang_codeCompleteAt(
+                static_cast<CXTranslationUnit>(TU.ptr),
+                complete_filename.c_str(), complete_line, complete_column,
+                convertedUnsavedFiles, numConvertedUnsavedFiles, options);
+            return Pointer(
+                {new CodeCompletionSession(results, complete_line,
+                                           complete_column)});
+          }));
+  emscripten::function("disposeCodeCompletionSession",
+                       emscripten::optional_override([](Pointer session) {
+                         delete static_cast<CodeCompletionSession *>(
+                             session.ptr);
+                       }));
+  emscripten::function(
+      "CodeCompletionSession_filter",
+      emscripten::optional_override([](Pointer session, unsigned line,
+                                       unsigned column, std::string prefix,
+                                       unsigned limit) {
+        const auto *s = static_cast<CodeCompletionSession *>(session.ptr);
+        if (!s->isWithinIdentifier(line, column, prefix)) {
+          return emscripten::val::null();
+        }
+        size_t matches = 0;
+        std::vector<const CompletionCandidate *> completions =
+            selectCompletions(s->candidates, prefix, limit, matches);
+        return encodeCompletions(completions, matches);
+      }));
   // skipped clang_sortCodeCompletionResults
   // skipped clang_disposeCodeCompleteResults
   // skipped clang_codeCompleteGetNumDiagnostics
@@ -1678,17 +4448,186 @@ EMSCRIPTEN_BINDINGS(libclagjs) {
   // skipped clang_index_setClientContainer
   // skipped clang_index_getClientEntity
   // skipped clang_index_setClientEntity
-  // skipped clang_IndexAction_create
-  // skipped clang_IndexAction_dispose
-  // skipped CXIndexOptFlags
-  // skipped clang_indexSourceFile
+  emscripten::function("IndexAction_create",
+                       emscripten::optional_override([](Pointer CIdx) {
+                         return Pointer({clang_IndexAction_create(CIdx.ptr)});
+                       }));
+  emscripten::function("IndexAction_dispose",
+                       emscripten::optional_override([](Pointer action) {
+                         clang_IndexAction_dispose(action.ptr);
+                       }));
+  emscripten::enum_<CXIndexOptFlags>("CXIndexOptFlags")
+      .value("None", CXIndexOpt_None)
+      .value("SuppressRedundantRefs", CXIndexOpt_SuppressRedundantRefs)
+      .value("IndexFunctionLocalSymbols", CXIndexOpt_IndexFunctionLocalSymbols)
+      .value("IndexImplicitTemplateInstantiations",
+             CXIndexOpt_IndexImplicitTemplateInstantiations)
+      .value("SuppressWarnings", CXIndexOpt_SuppressWarnings)
+      .value("SkipParsedBodiesInSession",
+             CXIndexOpt_SkipParsedBodiesInSession);
+  emscripten::enum_<IndexEventKind>("IndexEventKind")
+      .value("Declaration", IndexEventKind_Declaration)
+      .value("Reference", IndexEventKind_Reference);
+  emscripten::function(
+      "indexSourceFile",
+      emscripten::optional_override(
+          [](Pointer action, emscripten::val callback, unsigned index_options,
+             emscripten::val source_filename, emscripten::val command_line_args,
+             emscripten::val unsaved_files, unsigned TU_options,
+             emscripten::val batchSize) {
+            IndexClient client;
+            int ret = indexSourceFile(action.ptr, client, index_options,
+                                      source_filename, command_line_args,
+                                      unsaved_files, TU_options);
+            client.log.flush(callback, convertBatchSize(batchSize));
+            return ret;
+          }));
   // skipped clang_indexSourceFileFullArgv
-  // skipped clang_indexTranslationUnit
+  emscripten::function(
+      "indexTranslationUnit",
+      emscripten::optional_override([](Pointer action, emscripten::val callback,
+                                       unsigned index_options, Pointer TU,
+                                       emscripten::val batchSize) {
+        IndexClient client;
+        IndexerCallbacks callbacks = indexClientCallbacks();
+        int ret = clang_indexTranslationUnit(
+            action.ptr, &client, &callbacks, sizeof(callbacks), index_options,
+            static_cast<CXTranslationUnit>(TU.ptr));
+        client.log.flush(callback, convertBatchSize(batchSize));
+        return ret;
+      }));
+  emscripten::function("createSymbolIndex", emscripten::optional_override([]() {
+                         return Pointer({new SymbolIndex()});
+                       }));
+  emscripten::function("disposeSymbolIndex",
+                       emscripten::optional_override([](Pointer symbolIndex) {
+                         delete static_cast<SymbolIndex *>(symbolIndex.ptr);
+                       }));
+  emscripten::function(
+      "SymbolIndex_updateFromTranslationUnit",
+      emscripten::optional_override(
+          [](Pointer symbolIndex, Pointer action, Pointer TU) {
+            IndexClient client;
+            IndexerCallbacks callbacks = indexClientCallbacks();
+            int ret = clang_indexTranslationUnit(
+                action.ptr, &client, &callbacks, sizeof(callbacks),
+                CXIndexOpt_SuppressWarnings,
+                static_cast<CXTranslationUnit>(TU.ptr));
+            if (ret == 0) {
+              static_cast<SymbolIndex *>(symbolIndex.ptr)->update(client);
+            }
+            return ret;
+          }));
+  emscripten::function(
+      "SymbolIndex_removeFile",
+      emscripten::optional_override([](Pointer symbolIndex,
+                                       std::string filename) {
+        auto *index = static_cast<SymbolIndex *>(symbolIndex.ptr);
+        auto it = index->strings.indices.find(filename);
+        if (it == index->strings.indices.end() ||
+            !index->recordsByFile.count(it->second)) {
+          return false;
+        }
+        index->removeFile(it->second);
+        return true;
+      }));
+  emscripten::function(
+      "SymbolIndex_lookup",
+      emscripten::optional_override([](Pointer symbolIndex, std::string usr) {
+        return static_cast<SymbolIndex *>(symbolIndex.ptr)->lookup(usr, false);
+      }));
+  emscripten::function(
+      "SymbolIndex_lookupPrefix",
+      emscripten::optional_override([](Pointer symbolIndex,
+                                       std::string prefix) {
+        return static_cast<SymbolIndex *>(symbolIndex.ptr)
+            ->lookup(prefix, true);
+      }));
+  emscripten::function(
+      "SymbolIndex_save",
+      emscripten::optional_override([](Pointer symbolIndex,
+                                       std::string filename) {
+        return static_cast<SymbolIndex *>(symbolIndex.ptr)->save(filename);
+      }));
+  emscripten::function(
+      "SymbolIndex_load",
+      emscripten::optional_override([](Pointer symbolIndex,
+                                       std::string filename) {
+        return static_cast<SymbolIndex *>(symbolIndex.ptr)->load(filename);
+      }));
+  emscripten::function("createIndexingSession",
+                       emscripten::optional_override([](Pointer CIdx) {
+                         return Pointer({new IndexingSession(CIdx.ptr)});
+                       }));
+  emscripten::function("disposeIndexingSession",
+                       emscripten::optional_override([](Pointer session) {
+                         delete static_cast<IndexingSession *>(session.ptr);
+                       }));
+  emscripten::function(
+      "IndexingSession_indexSourceFile",
+      emscripten::optional_override(
+          [](Pointer session, emscripten::val callback, unsigned index_options,
+             emscripten::val source_filename, emscripten::val command_line_args,
+             emscripten::val unsaved_files, unsigned TU_options,
+             emscripten::val batchSize) {
+            IndexClient client;
+            client.session = static_cast<IndexingSession *>(session.ptr);
+            int ret = indexSourceFile(
+                client.session->action, client,
+                index_options | CXIndexOpt_SkipParsedBodiesInSession,
+                source_filename, command_line_args, unsaved_files, TU_options);
+            client.log.flush(callback, convertBatchSize(batchSize));
+            return ret;
+          }));
+  emscripten::function(
+      "IndexingSession_getStats",
+      emscripten::optional_override([](Pointer session) {
+        const auto *s = static_cast<IndexingSession *>(session.ptr);
+        emscripten::val ret = emscripten::val::object();
+        ret.set("translationUnits", s->translationUnits);
+        ret.set("indexedFiles", s->indexedFiles.size());
+        ret.set("skippedIncludes", s->skippedIncludes);
+        ret.set("importedASTFiles", s->importedASTFiles);
+        ret.set("reportedEvents", s->reportedEvents);
+        ret.set("droppedEvents", s->droppedEvents);
+        return ret;
+      }));
   // skipped clang_indexLoc_getFileLocation
   // skipped clang_indexLoc_getCXSourceLocation
   // skipped clang_Type_visitFields
   emscripten::class_<Pointer>("Pointer");
+  emscripten::class_<UnsavedFileStoreHandle>("UnsavedFileStore");
+  emscripten::function(
+      "countLivePointers",
+      emscripten::optional_override([]() { return livePointers.load(); }));
   emscripten::function("isNullPointer",
                        emscripten::optional_override(
                            [](const Pointer &p) { return p.ptr == nullptr; }));
+  emscripten::function("getPointerAddress",
+                       emscripten::optional_override([](const Pointer &p) {
+                         return reinterpret_cast<uintptr_t>(p.ptr);
+                       }));
+  emscripten::function(
+      "getHeapStats", emscripten::optional_override([]() {
+        // dlmalloc serves all threads from a single heap, so there are no
+        // per-thread arenas to report.
+        struct mallinfo info = mallinfo();
+        emscripten::val ret = emscripten::val::object();
+        ret.set("heapSize", static_cast<double>(emscripten_get_heap_size()));
+        ret.set("heapMax", static_cast<double>(emscripten_get_heap_max()));
+        ret.set("arenaBytes", static_cast<double>(info.arena));
+        ret.set("inUseBytes",
+                static_cast<double>(info.uordblks + info.hblkhd));
+        ret.set("freeBytes", static_cast<double>(info.fordblks));
+        ret.set("freeChunks", info.ordblks);
+        ret.set("releasableBytes", static_cast<double>(info.keepcost));
+        // Free memory below the top chunk can only be reused by allocations
+        // which fit into the holes.
+        ret.set("fragmentation",
+                info.fordblks == 0
+                    ? 0.0
+                    : static_cast<double>(info.fordblks - info.keepcost) /
+                          info.fordblks);
+        return ret;
+      }));
 }
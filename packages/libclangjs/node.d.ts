@@ -1,4 +1,3 @@
-import { EmscriptenModule } from "./emscripten";
-import { LibClang } from "./libclangjs";
+import { LibClang, LibClangOptions } from "./libclangjs";
 
-export default function init(module?: EmscriptenModule): Promise<LibClang>;
+export default function init(module?: LibClangOptions): Promise<LibClang>;
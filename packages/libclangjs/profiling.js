@@ -0,0 +1,95 @@
+// Opt-in profiling of the bindings, linked with --post-js. When the module is
+// initialized with `libclangjsProfiling: true`, every bound function is
+// wrapped to record its call count, time and marshalled bytes, plus a Chrome
+// trace event per call. Without the option, no function is wrapped.
+
+var bindingProfile = {};
+var bindingTraceEvents = [];
+var bindingProfileStack = [];
+// Trace events are dropped beyond this count to bound memory use.
+var maxBindingTraceEvents = 1000000;
+
+function marshalledBytes(value) {
+  if (typeof value === "string") {
+    return value.length;
+  }
+  if (ArrayBuffer.isView(value) || value instanceof ArrayBuffer) {
+    return value.byteLength;
+  }
+  var bytes = 0;
+  if (Array.isArray(value)) {
+    for (var i = 0; i < value.length; i++) {
+      bytes += marshalledBytes(value[i]);
+    }
+  } else if (value !== null && typeof value === "object" &&
+             Object.getPrototypeOf(value) === Object.prototype) {
+    for (var key in value) {
+      bytes += marshalledBytes(value[key]);
+    }
+  }
+  return bytes;
+}
+
+function profileBinding(name, func) {
+  var wrapper = function() {
+    var entry = bindingProfile[name];
+    if (entry === undefined) {
+      entry = bindingProfile[name] = { name: name, calls: 0, totalTime: 0, selfTime: 0, bytes: 0 };
+    }
+    var frame = { childTime: 0 };
+    bindingProfileStack.push(frame);
+    var start = performance.now();
+    var ret;
+    try {
+      ret = func.apply(this, arguments);
+    } finally {
+      var duration = performance.now() - start;
+      bindingProfileStack.pop();
+      if (bindingProfileStack.length > 0) {
+        bindingProfileStack[bindingProfileStack.length - 1].childTime += duration;
+      }
+      entry.calls++;
+      entry.totalTime += duration;
+      entry.selfTime += duration - frame.childTime;
+      entry.bytes += marshalledBytes(Array.prototype.slice.call(arguments)) + marshalledBytes(ret);
+      if (bindingTraceEvents.length < maxBindingTraceEvents) {
+        bindingTraceEvents.push({
+          name: name, cat: "libclangjs", ph: "X",
+          ts: start * 1000, dur: duration * 1000,
+          pid: 1, tid: 1,
+        });
+      }
+    }
+    return ret;
+  };
+  wrapper.argCount = func.argCount;
+  return wrapper;
+}
+
+if (!ENVIRONMENT_IS_PTHREAD && Module["libclangjsProfiling"]) {
+  // Bound functions are registered while the runtime initializes. Embind
+  // marks them with their number of arguments.
+  addOnPostRun(function() {
+    for (var name in Module) {
+      var func = Module[name];
+      if (typeof func === "function" && typeof func.argCount === "number") {
+        Module[name] = profileBinding(name, func);
+      }
+    }
+  });
+}
+
+Module["getBindingProfile"] = function() {
+  return Object.keys(bindingProfile)
+    .map(function(name) { return Object.assign({}, bindingProfile[name]); })
+    .sort(function(a, b) { return b.selfTime - a.selfTime; });
+};
+
+Module["resetBindingProfile"] = function() {
+  bindingProfile = {};
+  bindingTraceEvents = [];
+};
+
+Module["getBindingTrace"] = function() {
+  return { traceEvents: bindingTraceEvents.slice(), displayTimeUnit: "ms" };
+};
@@ -0,0 +1,117 @@
+/**
+ * An address in the WebAssembly heap.
+ */
+export type RawPointer = number;
+
+/**
+ * Fast path to the cursor, type and location accessors, which bypasses
+ * embind. Functions take and return numbers only. Only the accessors below
+ * are covered; diagnostics, tokens, completion and the rest of the API are
+ * only available on {@link LibClang}.
+ *
+ * Structs are passed by pointer into scratch memory of the caller, allocated
+ * with {@link RawLibClang.malloc | malloc()} and sized with the `sizeof*`
+ * functions. Accessors returning a struct write it to an `out` pointer.
+ * Handles such as translation units are passed by address, see
+ * {@link LibClang.getPointerAddress | getPointerAddress()}. Strings are
+ * returned as pointers to be read with {@link RawLibClang.string | string()};
+ * they stay valid until the next string is returned. Unsigned results, such
+ * as hashes and pointers, are returned as non-negative numbers.
+ *
+ * The functions operate on the heap of a loaded module, so they are reached
+ * as {@link LibClang.raw} of the module returned by `init()` rather than
+ * through an entry point of their own. This file only provides their types.
+ *
+ * @example
+ * const cursor = raw.malloc(raw.sizeofCursor());
+ * raw.getTranslationUnitCursor(clang.getPointerAddress(tu), cursor);
+ * const spelling = raw.string(raw.getCursorSpelling(cursor));
+ * raw.free(cursor);
+ */
+export type RawLibClang = {
+  /**
+   * Return a view of the heap as 32 bit words, recreated if the heap has
+   * grown.
+   */
+  HEAPU32: () => Uint32Array;
+
+  /**
+   * Decode a UTF-8 string returned by a raw function.
+   */
+  string: (ptr: RawPointer) => string;
+
+  malloc: (size: number) => RawPointer;
+  free: (ptr: RawPointer) => void;
+
+  sizeofCursor: () => number;
+  sizeofType: () => number;
+  sizeofSourceLocation: () => number;
+  sizeofSourceRange: () => number;
+
+  getTranslationUnitCursor: (tu: RawPointer, out: RawPointer) => void;
+
+  /**
+   * Write up to \p capacity children of \p parent to consecutive cursors
+   * starting at \p out.
+   *
+   * @returns The number of children, which may exceed \p capacity.
+   */
+  getChildren: (parent: RawPointer, out: RawPointer, capacity: number) => number;
+
+  getCursorKind: (cursor: RawPointer) => number;
+  hashCursor: (cursor: RawPointer) => number;
+  equalCursors: (a: RawPointer, b: RawPointer) => number;
+  Cursor_isNull: (cursor: RawPointer) => number;
+  isDeclaration: (kind: number) => number;
+  isReference: (kind: number) => number;
+  isExpression: (kind: number) => number;
+  getCursorLinkage: (cursor: RawPointer) => number;
+  Cursor_getNumArguments: (cursor: RawPointer) => number;
+  Cursor_getArgument: (cursor: RawPointer, i: number, out: RawPointer) => void;
+  getCursorSemanticParent: (cursor: RawPointer, out: RawPointer) => void;
+  getCursorLexicalParent: (cursor: RawPointer, out: RawPointer) => void;
+  getCursorReferenced: (cursor: RawPointer, out: RawPointer) => void;
+  getCursorDefinition: (cursor: RawPointer, out: RawPointer) => void;
+  getCanonicalCursor: (cursor: RawPointer, out: RawPointer) => void;
+  getCursorLocation: (cursor: RawPointer, out: RawPointer) => void;
+  getCursorExtent: (cursor: RawPointer, out: RawPointer) => void;
+  getCursorType: (cursor: RawPointer, out: RawPointer) => void;
+  getCursorResultType: (cursor: RawPointer, out: RawPointer) => void;
+  getTypedefDeclUnderlyingType: (cursor: RawPointer, out: RawPointer) => void;
+  getCursorSpelling: (cursor: RawPointer) => RawPointer;
+  getCursorDisplayName: (cursor: RawPointer) => RawPointer;
+  getCursorUSR: (cursor: RawPointer) => RawPointer;
+
+  getTypeKind: (type: RawPointer) => number;
+  getTypeSpelling: (type: RawPointer) => RawPointer;
+  equalTypes: (a: RawPointer, b: RawPointer) => number;
+  getNumArgTypes: (type: RawPointer) => number;
+  getArgType: (type: RawPointer, i: number, out: RawPointer) => void;
+  getCanonicalType: (type: RawPointer, out: RawPointer) => void;
+  getPointeeType: (type: RawPointer, out: RawPointer) => void;
+  getResultType: (type: RawPointer, out: RawPointer) => void;
+  getTypeDeclaration: (type: RawPointer, out: RawPointer) => void;
+
+  equalRanges: (a: RawPointer, b: RawPointer) => number;
+  getRangeStart: (range: RawPointer, out: RawPointer) => void;
+  getRangeEnd: (range: RawPointer, out: RawPointer) => void;
+
+  equalLocations: (a: RawPointer, b: RawPointer) => number;
+  Location_isFromMainFile: (location: RawPointer) => number;
+
+  /**
+   * Write the line and column of a location as two 32 bit words to \p out.
+   *
+   * @returns The presumed file name.
+   */
+  getPresumedLocation: (location: RawPointer, out: RawPointer) => RawPointer;
+
+  /**
+   * Write the file handle, line, column and offset of a location as four
+   * 32 bit words to \p out.
+   */
+  getSpellingLocation: (location: RawPointer, out: RawPointer) => void;
+  getExpansionLocation: (location: RawPointer, out: RawPointer) => void;
+  getFileLocation: (location: RawPointer, out: RawPointer) => void;
+  getFileName: (file: RawPointer) => RawPointer;
+};
@@ -0,0 +1,49 @@
+// The `raw` surface over the libclangjs_raw_* exports of main.cpp, linked with
+// --post-js after rawFunctions.js, which CMakeLists.txt generates from the
+// declarations in main.cpp. rawFunctionNames lists the exports without the
+// libclangjs_raw_ prefix, rawUnsignedFunctionNames those returning unsigned
+// values, which wasm returns as signed numbers. A missing export fails at
+// startup.
+
+var rawHeapBuffer = null;
+var rawHeapU32 = null;
+
+var raw = {
+  // Views of the heap must be recreated after it grows, which may happen on
+  // any thread.
+  HEAPU32: function() {
+    if (rawHeapBuffer !== wasmMemory.buffer) {
+      rawHeapBuffer = wasmMemory.buffer;
+      rawHeapU32 = new Uint32Array(rawHeapBuffer);
+    }
+    return rawHeapU32;
+  },
+  string: function(ptr) {
+    return UTF8ToString(ptr);
+  },
+};
+Module["raw"] = raw;
+
+// Older versions of Emscripten export a wrapper, which replaces the export with
+// the wasm function on its first call, so the function is looked up again
+// after that.
+function bindRawFunction(name) {
+  var exportName = "_libclangjs_raw_" + name;
+  if (typeof Module[exportName] !== "function") {
+    throw new Error("libclangjs_raw_" + name + " is not exported");
+  }
+  var unsigned = rawUnsignedFunctionNames.indexOf(name) !== -1;
+  raw[name] = function() {
+    var ret = Module[exportName].apply(null, arguments);
+    var fn = Module[exportName];
+    // No unsigned function takes more than three arguments.
+    raw[name] = unsigned ? function(a, b, c) { return fn(a, b, c) >>> 0; } : fn;
+    return unsigned ? ret >>> 0 : ret;
+  };
+}
+
+if (!ENVIRONMENT_IS_PTHREAD) {
+  addOnPostRun(function() {
+    rawFunctionNames.forEach(bindRawFunction);
+  });
+}
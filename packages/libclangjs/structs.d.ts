@@ -34,10 +34,18 @@ export type CXUnsavedFile = {
 
   /**
    * A buffer containing the unsaved contents of this file.
+   *
+   * Binary contents are copied into the WebAssembly heap as-is, which avoids
+   * re-encoding large generated files on every reparse.
    */
-  contents: string;
+  contents: string | Uint8Array | ArrayBuffer;
 };
 
+/**
+ * A set of unsaved files kept in the WebAssembly heap between calls.
+ */
+export type UnsavedFileStore = {};
+
 /**
  * A cursor representing some element in the abstract syntax tree for
  * a translation unit.
@@ -59,6 +67,91 @@ export type CXUnsavedFile = {
 export type CXCursor = {
   kind: EnumValue<CXCursorKind>;
   xdata: number;
+  /**
+   * Opaque data of libclang. Cursors are plain objects which are copied in
+   * and out of the WebAssembly heap, so they need not be deleted, but they
+   * must be passed back unmodified. Their `delete()` method does nothing and
+   * is only kept for existing callers.
+   */
+  data0: number;
+  data1: number;
+  data2: number;
+};
+
+/**
+ * Selects the cursors reported by {@link LibClang.visitChildrenFiltered | visitChildrenFiltered()}.
+ */
+export type CursorFilter = {
+  /**
+   * Only report cursors of these kinds. All kinds are reported if omitted.
+   */
+  kinds?: EnumValue<CXCursorKind>[] | null;
+
+  /**
+   * Skip cursors (and their subtrees) that are not located in the main file.
+   */
+  mainFileOnly?: boolean;
+
+  /**
+   * Skip cursors (and their subtrees) that are located in system headers.
+   */
+  excludeSystemHeaders?: boolean;
+
+  /**
+   * Do not descend below this depth, where direct children of the parent
+   * cursor have depth 1. The depth is unlimited if omitted or 0.
+   */
+  maxDepth?: number | null;
+};
+
+/**
+ * A flattened cursor subtree, as returned by {@link LibClang.exportCursorTree | exportCursorTree()}.
+ *
+ * Cursors are stored in pre-order as parallel arrays, so the columns for
+ * cursor `i` are `kind[i]`, `parent[i]`, etc. Only the columns selected by the
+ * field mask are present.
+ */
+export type CursorTree = {
+  /**
+   * The number of cursors in the tree, not counting the root.
+   */
+  length: number;
+  kind?: Uint16Array;
+  parent?: Int32Array;
+  depth?: Uint32Array;
+  file?: Uint32Array;
+  /**
+   * File names referenced by `file`. Cursors without a file map to `""`.
+   */
+  files?: string[];
+  startOffset?: Uint32Array;
+  endOffset?: Uint32Array;
+  spelling?: Uint32Array;
+  /**
+   * Spellings referenced by `spelling`.
+   */
+  strings?: string[];
+};
+
+/**
+ * Tokens of a range as produced by {@link LibClang.tokenizeRange | tokenizeRange()}, with one
+ * entry per token in each array.
+ */
+export type TokenList = {
+  /**
+   * The {@link CXTokenKind} value of each token.
+   */
+  kind: Uint8Array;
+  /**
+   * The offset of each token into its file.
+   */
+  offset: Uint32Array;
+  length: Uint32Array;
+  /**
+   * The {@link CXCursorKind} value of the cursor each token is annotated
+   * with. Only present when annotation was requested.
+   */
+  cursorKind?: Uint16Array;
 };
 
 /**
@@ -69,6 +162,11 @@ export type CXCursor = {
  * to map a source location to a particular file, line, and column.
  */
 export type CXSourceLocation = {
+  /**
+   * Opaque data of libclang, see {@link CXCursor.data0}.
+   */
+  ptr_data0: number;
+  ptr_data1: number;
   int_data: number;
 };
 
@@ -79,6 +177,11 @@ export type CXSourceLocation = {
  * starting and end locations from a source range, respectively.
  */
 export type CXSourceRange = {
+  /**
+   * Opaque data of libclang, see {@link CXCursor.data0}.
+   */
+  ptr_data0: number;
+  ptr_data1: number;
   begin_int_data: number;
   end_int_data: number;
 };
@@ -105,6 +208,11 @@ export type CXCursorSetImpl = {};
  */
 export type CXType = {
   kind: EnumValue<CXTypeKind>;
+  /**
+   * Opaque data of libclang, see {@link CXCursor.data0}.
+   */
+  data0: number;
+  data1: number;
 };
 
 /**
@@ -158,6 +266,45 @@ export type CXCompletionResult = {
   CompletionString: EnumValue<CXCompletionString>;
 };
 
+/**
+ * Completions as produced by {@link LibClang.codeCompleteAt | codeCompleteAt()}.
+ *
+ * The chunks of completion `i` are the entries `chunkOffsets[i]` up to
+ * (excluding) `chunkOffsets[i + 1]` of `chunkKind` and `chunkText`.
+ */
+export type CompletionList = {
+  /**
+   * The number of returned completions.
+   */
+  length: number;
+  /**
+   * The number of completions matching the prefix, before applying the
+   * limit.
+   */
+  matches: number;
+  /**
+   * The {@link CXCursorKind} value of each completion.
+   */
+  cursorKind: Uint16Array;
+  priority: Uint32Array;
+  chunkOffsets: Uint32Array;
+  /**
+   * The {@link CXCompletionChunkKind} value of each chunk.
+   */
+  chunkKind: Uint8Array;
+  /**
+   * The index into `strings` of the text of each chunk. The text of optional
+   * chunks is the concatenated text of their nested chunks.
+   */
+  chunkText: Uint32Array;
+  strings: string[];
+};
+
+/**
+ * Code completion results kept alive for re-filtering while typing.
+ */
+export type CodeCompletionSession = {};
+
 /**
  * The client's data object that is associated with a CXFile.
  */
@@ -180,6 +327,135 @@ export type CXIdxClientContainer = {};
  */
 export type CXIdxClientASTFile = {};
 
+/**
+ * An indexing action/session, to be applied to one or multiple
+ * translation units.
+ */
+export type CXIndexAction = {};
+
+/**
+ * A map from USRs to the locations where the corresponding entities are
+ * declared, defined or referenced.
+ */
+export type SymbolIndex = {};
+
+/**
+ * Locations returned by {@link LibClang.SymbolIndex_lookup | SymbolIndex_lookup()}, with one entry
+ * per location in each array, ordered by USR.
+ */
+export type SymbolLocations = {
+  length: number;
+  /**
+   * The index into `strings` of the USR of each location.
+   */
+  usr: Uint32Array;
+  /**
+   * The index into `strings` of the file of each location.
+   */
+  file: Uint32Array;
+  line: Uint32Array;
+  column: Uint32Array;
+  offset: Uint32Array;
+  /**
+   * A bitset of {@link CXSymbolRole} values.
+   */
+  role: Uint32Array;
+  /**
+   * USRs and file names referenced by `usr` and `file`.
+   */
+  strings: string[];
+};
+
+/**
+ * An indexing session spanning several translation units, which reports the
+ * events of each header only once.
+ */
+export type IndexingSession = {};
+
+/**
+ * Statistics of an {@link IndexingSession}.
+ */
+export type IndexingSessionStats = {
+  /**
+   * The number of translation units indexed in the session.
+   */
+  translationUnits: number;
+  /**
+   * The number of distinct headers indexed in the session. Main files are
+   * not counted, as they are reported each time they are indexed.
+   */
+  indexedFiles: number;
+  /**
+   * The number of times a file which was already indexed as part of an
+   * earlier translation unit was entered.
+   */
+  skippedIncludes: number;
+  /**
+   * The number of AST files (PCH or modules) imported.
+   */
+  importedASTFiles: number;
+  /**
+   * The number of events passed to callbacks.
+   */
+  reportedEvents: number;
+  /**
+   * The number of events dropped because they were located in files indexed
+   * as part of an earlier translation unit.
+   */
+  droppedEvents: number;
+};
+
+/**
+ * A batch of events reported by {@link LibClang.indexSourceFile | indexSourceFile()} or
+ * {@link LibClang.indexTranslationUnit | indexTranslationUnit()}, with one entry per event in
+ * each array.
+ */
+export type IndexEvents = {
+  /**
+   * The number of events in this batch.
+   */
+  length: number;
+  /**
+   * The {@link IndexEventKind} value of each event.
+   */
+  kind: Uint8Array;
+  /**
+   * The {@link CXIdxEntityKind} value of the declared or referenced entity.
+   */
+  entityKind: Uint8Array;
+  /**
+   * The index into `strings` of the USR of the entity.
+   */
+  usr: Uint32Array;
+  /**
+   * The index into `strings` of the name of the entity.
+   */
+  name: Uint32Array;
+  /**
+   * The index into `files` of the file of each event. Events without a file
+   * map to `""`.
+   */
+  file: Uint32Array;
+  line: Uint32Array;
+  column: Uint32Array;
+  offset: Uint32Array;
+  /**
+   * A bitset of {@link CXSymbolRole} values. Declarations carry
+   * `Declaration`, plus `Definition` and `Implicit` where applicable.
+   */
+  role: Uint32Array;
+  /**
+   * USRs and names referenced by `usr` and `name`. The same array is shared
+   * by all batches of one call.
+   */
+  strings: string[];
+  /**
+   * File names referenced by `file`. The same array is shared by all batches
+   * of one call.
+   */
+  files: string[];
+};
+
 /**
  * Source location passed to index callbacks.
  */
@@ -316,3 +592,153 @@ export type CXIdxEntityRefInfo = {
    */
   role: EnumValue<CXSymbolRole>;
 };
+
+/**
+ * A pool of translation units kept within a memory budget.
+ */
+export type TranslationUnitCache = {};
+
+/**
+ * Statistics of a {@link TranslationUnitCache}.
+ */
+export type TranslationUnitCacheStats = {
+  /**
+   * The number of cached translation units.
+   */
+  entries: number;
+  /**
+   * The number of cached translation units which are suspended.
+   */
+  suspendedEntries: number;
+  /**
+   * The number of cached translation units which are in use, i.e. returned
+   * and not yet released.
+   */
+  pinnedEntries: number;
+  /**
+   * The memory of all cached translation units in bytes, as reported by
+   * libclang.
+   */
+  bytes: number;
+  /**
+   * The memory budget in bytes.
+   */
+  budget: number;
+  /**
+   * The number of lookups which returned a cached translation unit.
+   */
+  hits: number;
+  /**
+   * The number of lookups which parsed the source file.
+   */
+  misses: number;
+  /**
+   * The number of translation units suspended to stay within the budget.
+   */
+  suspensions: number;
+  /**
+   * The number of translation units disposed to stay within the budget.
+   */
+  evictions: number;
+};
+
+/**
+ * The memory usage of one or more translation units, broken down by
+ * category. Entry `i` reports `bytes[i]` bytes for the category whose
+ * {@link CXTUResourceUsageKind} value is `kind[i]`.
+ */
+export type TUResourceUsage = {
+  kind: Uint32Array;
+  bytes: Float64Array;
+};
+
+/**
+ * The memory usage of all live translation units of an index.
+ */
+export type IndexResourceUsage = TUResourceUsage & {
+  /**
+   * The number of translation units included in the totals.
+   */
+  translationUnits: number;
+  /**
+   * The number of translation units left out of the totals, because they are
+   * being reparsed asynchronously.
+   */
+  busyTranslationUnits: number;
+};
+
+/**
+ * Statistics of the WebAssembly heap and of the allocator. All threads share
+ * a single allocator heap.
+ */
+export type HeapStats = {
+  /**
+   * The current size of the WebAssembly memory in bytes.
+   */
+  heapSize: number;
+  /**
+   * The size up to which the WebAssembly memory may grow, in bytes.
+   */
+  heapMax: number;
+  /**
+   * The bytes obtained by the allocator from the heap.
+   */
+  arenaBytes: number;
+  /**
+   * The bytes in allocated blocks.
+   */
+  inUseBytes: number;
+  /**
+   * The bytes in free blocks, including the top chunk.
+   */
+  freeBytes: number;
+  /**
+   * The number of free blocks.
+   */
+  freeChunks: number;
+  /**
+   * The bytes in the free top chunk of the heap, which any allocation can use.
+   */
+  releasableBytes: number;
+  /**
+   * The share of free bytes outside of the top chunk, between 0 and 1.
+   */
+  fragmentation: number;
+};
+
+/**
+ * The calls of a bound function recorded in profiling mode.
+ */
+export type BindingProfileEntry = {
+  /**
+   * The name of the function.
+   */
+  name: string;
+  /**
+   * The number of calls.
+   */
+  calls: number;
+  /**
+   * The time spent in the function in milliseconds, including marshalling.
+   */
+  totalTime: number;
+  /**
+   * The time spent in the function in milliseconds, excluding calls to other
+   * bound functions from callbacks.
+   */
+  selfTime: number;
+  /**
+   * The bytes of strings, typed arrays and array buffers passed to and
+   * returned from the function, approximating the marshalling volume.
+   */
+  bytes: number;
+};
+
+/**
+ * A timeline of calls in the Chrome trace event format, which can be loaded
+ * in chrome://tracing or Perfetto after serializing it with `JSON.stringify`.
+ */
+export type BindingTrace = {
+  traceEvents: { name: string, cat: string, ph: "X", ts: number, dur: number, pid: number, tid: number }[];
+  displayTimeUnit: "ms";
+};
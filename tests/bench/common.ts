@@ -0,0 +1,64 @@
+import init from "libclangjs/node";
+import { LibClang } from "libclangjs/libclangjs";
+import { execSync } from "child_process";
+import path from "path";
+import fs from "fs";
+
+export const cwd = "/home/web_user";
+
+export const initClang = async () => {
+  const clang = await init();
+  clang.FS.mkdirTree(cwd);
+  return clang;
+};
+
+/**
+ * Mounts the emscripten sysroot and the clang builtin headers and returns the
+ * command line arguments needed to parse code using the standard library.
+ */
+export const mountStandardLibrary = (clang: LibClang) => {
+  const cache = execSync("em-config CACHE", { encoding: "utf8" }).trim();
+  const sysroot = path.join(cache, "sysroot", "include");
+  const clangLib = path.join(__dirname, "node_modules", "llvm-project-emscripten", "dist", "lib", "clang");
+  const builtins = path.join(clangLib, fs.readdirSync(clangLib)[0], "include");
+  const mounts: [string, string][] = [[sysroot, "/sysroot"], [builtins, "/builtins"]];
+  for (const [root, mountPoint] of mounts) {
+    clang.FS.mkdirTree(mountPoint);
+    clang.FS.mount(clang.NODEFS, { root }, mountPoint);
+  }
+  return [
+    "-target", "wasm32-unknown-emscripten",
+    "-nostdinc",
+    "-isystem", "/sysroot/c++/v1",
+    "-isystem", "/builtins",
+    "-isystem", "/sysroot",
+    "-std=c++17",
+  ];
+};
+
+/**
+ * Mounts the standard library PCH bundles written by the libclangjs build at
+ * /stdlib-pch and returns the path of their manifest, or undefined if they
+ * have not been built.
+ */
+export const mountStdlibPch = (clang: LibClang) => {
+  const root = path.join(__dirname, "node_modules", "libclangjs", "stdlib-pch");
+  if (!fs.existsSync(path.join(root, "manifest.json"))) return undefined;
+  clang.FS.mkdirTree("/stdlib-pch");
+  clang.FS.mount(clang.NODEFS, { root }, "/stdlib-pch");
+  return "/stdlib-pch/manifest.json";
+};
+
+/**
+ * Runs `fn` `iterations` times and returns the median wall time in milliseconds.
+ */
+export const measure = (fn: () => void, iterations = 5) => {
+  const times: number[] = [];
+  for (let i = 0; i < iterations; i++) {
+    const start = performance.now();
+    fn();
+    times.push(performance.now() - start);
+  }
+  times.sort((a, b) => a - b);
+  return times[Math.floor(times.length / 2)];
+};
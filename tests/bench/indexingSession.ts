@@ -0,0 +1,62 @@
+import { initClang, cwd } from "./common";
+
+const headerCount = 50;
+const functionsPerHeader = 40;
+const tuCount = 20;
+
+// Indexes a synthetic project in which every translation unit includes the
+// same headers, once with a fresh index action per translation unit and once
+// within a single indexing session.
+const run = async () => {
+  const clang = await initClang();
+  const headers = Array.from({ length: headerCount }, (_, h) => {
+    const fileName = `${cwd}/header${h}.hpp`;
+    clang.FS.writeFile(fileName, [
+      "#pragma once",
+      ...Array.from({ length: functionsPerHeader }, (_, f) =>
+        `inline int h${h}f${f}(int x) { int y = x * ${f}; for (int i = 0; i < x; i++) { y += i ^ ${h}; } return y; }`),
+    ].join("\n"));
+    return fileName;
+  });
+  const sources = Array.from({ length: tuCount }, (_, t) => {
+    const fileName = `${cwd}/source${t}.cpp`;
+    clang.FS.writeFile(fileName, [
+      ...headers.map((h) => `#include "${h}"`),
+      `int source${t}() { return h0f0(${t}); }`,
+    ].join("\n"));
+    return fileName;
+  });
+  const index = clang.createIndex(0, 0);
+
+  let separateEvents = 0;
+  let start = performance.now();
+  for (const source of sources) {
+    const action = clang.IndexAction_create(index);
+    clang.indexSourceFile(action, (batch) => { separateEvents += batch.length; }, 0, source, null, null, 0, null);
+    clang.IndexAction_dispose(action);
+  }
+  const separate = performance.now() - start;
+
+  let sessionEvents = 0;
+  const session = clang.createIndexingSession(index);
+  start = performance.now();
+  for (const source of sources) {
+    clang.IndexingSession_indexSourceFile(session, (batch) => { sessionEvents += batch.length; }, 0, source, null, null, 0, null);
+  }
+  const shared = performance.now() - start;
+  const stats = clang.IndexingSession_getStats(session);
+  clang.disposeIndexingSession(session);
+
+  console.log(`${tuCount} translation units including ${headerCount} headers with ${functionsPerHeader} functions each`);
+  console.table({
+    "action per translation unit": { "ms": separate.toFixed(0), "events": separateEvents },
+    "indexing session": { "ms": shared.toFixed(0), "events": sessionEvents },
+  });
+  console.log(`Saved ${(separate - shared).toFixed(0)} ms (${(100 * (1 - shared / separate)).toFixed(0)}%)`);
+  console.log(stats);
+
+  clang.disposeIndex(index);
+  clang.PThread.terminateAllThreads();
+};
+
+run();
@@ -0,0 +1,67 @@
+// Source parsed by the microbenchmarks in microbench.ts and native/main.cpp.
+
+namespace shapes {
+
+template <typename T> struct Point {
+  T x;
+  T y;
+  T dot(const Point &other) const { return x * other.x + y * other.y; }
+};
+
+class Shape {
+public:
+  virtual ~Shape() = default;
+  virtual double area() const = 0;
+  int id = 0;
+};
+
+class Rectangle : public Shape {
+public:
+  Rectangle(double width, double height) : width(width), height(height) {}
+  double area() const override { return width * height; }
+
+private:
+  double width;
+  double height;
+};
+
+class Circle : public Shape {
+public:
+  explicit Circle(double radius) : radius(radius) {}
+  double area() const override { return 3.14159 * radius * radius; }
+
+private:
+  double radius;
+};
+
+enum class Color { Red, Green, Blue };
+
+double totalArea(const Shape *const *shapes, int count) {
+  double total = 0;
+  for (int i = 0; i < count; i++) {
+    total += shapes[i]->area();
+  }
+  return total;
+}
+
+int mix(Color a, Color b) {
+  switch (a) {
+  case Color::Red:
+    return b == Color::Red ? 0 : 1;
+  case Color::Green:
+    return b == Color::Blue ? 2 : 3;
+  default:
+    return 4 * static_cast<int>(b);
+  }
+}
+
+} // namespace shapes
+
+int main() {
+  shapes::Rectangle rectangle(2, 3);
+  shapes::Circle circle(1);
+  const shapes::Shape *all[] = {&rectangle, &circle};
+  shapes::Point<int> p{1, 2};
+  return static_cast<int>(shapes::totalArea(all, 2)) + p.dot(p) +
+         shapes::mix(shapes::Color::Red, shapes::Color::Blue);
+}
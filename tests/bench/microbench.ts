@@ -0,0 +1,154 @@
+import fs from "fs";
+import path from "path";
+import { Session } from "inspector";
+import { CXCursor, CXSourceLocation, CXSourceRange, CXType } from "libclangjs/libclangjs";
+import { initClang } from "./common";
+
+// Times every binding which takes a single cursor, type, source location or
+// source range, over the cursors of microbench.cpp and their types, locations
+// and extents. The bindings are read from libclangjs.d.ts, so new ones are
+// picked up without changes here. Reports, per call, the time, the number of
+// JS objects allocated and the growth of the wasm heap. If native/build.ts was
+// run before, the time of the same calls made natively is shown alongside for
+// the accessors native/main.cpp covers. Results saved by an earlier run, e.g.
+// of another build, are compared with --baseline <results.json>.
+//
+// Must be run with --expose-gc:
+//
+//   node --expose-gc -r ts-node/register microbench.ts
+
+const iterations = 200;
+// Calls whose allocations are counted, which sample every allocation and are
+// therefore much slower.
+const allocationIterations = 2;
+const resultsPath = path.join(__dirname, "microbench-results.json");
+const nativeResultsPath = path.join(__dirname, "microbench-native.json");
+const declarationsPath = path.join(__dirname, "node_modules", "libclangjs", "libclangjs.d.ts");
+const baselineIndex = process.argv.indexOf("--baseline");
+const baselinePath = baselineIndex === -1 ? undefined : process.argv[baselineIndex + 1];
+
+// Bindings which cannot be called in a loop, because their results must be
+// disposed with another function.
+const skipped = new Set(["getCursorPrintingPolicy"]);
+
+const gc = (global as any).gc as (() => void) | undefined;
+if (gc === undefined) throw new Error("Run with --expose-gc");
+
+const session = new Session();
+session.connect();
+const post = (method: string, params?: object) => new Promise<any>((resolve, reject) => {
+  session.post(method, params, (error, result) => error ? reject(error) : resolve(result));
+});
+
+// Returns the number of JS objects allocated by `fn`. With a sampling interval
+// of one byte, the sampling heap profiler records every allocation, and
+// objects collected in the meantime are kept in the profile.
+const countAllocations = async (fn: () => void) => {
+  await post("HeapProfiler.startSampling", {
+    samplingInterval: 1,
+    includeObjectsCollectedByMajorGC: true,
+    includeObjectsCollectedByMinorGC: true,
+  });
+  fn();
+  const { profile } = await post("HeapProfiler.stopSampling");
+  return profile.samples.length as number;
+};
+
+// Values of embind classes, e.g. handles, must be deleted, so that is part of
+// each call. Cursors, types, locations and ranges have a no-op delete().
+const release = (value: any) => {
+  if (value !== null && typeof value === "object" && typeof value.delete === "function") {
+    value.delete();
+  }
+};
+
+const run = async () => {
+  const clang = await initClang();
+  clang.FS.writeFile("/microbench.cpp", fs.readFileSync(path.join(__dirname, "microbench.cpp")));
+  const index = clang.createIndex(0, 0);
+  const tu = clang.parseTranslationUnit(index, "/microbench.cpp", null, null, 0);
+  if (clang.isNullPointer(tu)) throw new Error("Cannot parse microbench.cpp");
+  const cursors: CXCursor[] = [];
+  clang.visitChildren(clang.getTranslationUnitCursor(tu), (c) => {
+    cursors.push(c);
+    return clang.CXChildVisitResult.Recurse;
+  });
+  const values: Record<string, (CXCursor | CXType | CXSourceLocation | CXSourceRange)[]> = {
+    CXCursor: cursors,
+    CXType: cursors.map((c) => clang.getCursorType(c)),
+    CXSourceLocation: cursors.map((c) => clang.getCursorLocation(c)),
+    CXSourceRange: cursors.map((c) => clang.getCursorExtent(c)),
+  };
+
+  // Each benchmark makes one call per cursor.
+  const benchmarks: Record<string, (i: number) => any> = {};
+  const declaration = /^  (\w+): \(\w+: (CXCursor|CXType|CXSourceLocation|CXSourceRange)\) =>/gm;
+  for (const [, name, type] of fs.readFileSync(declarationsPath, "utf8").matchAll(declaration)) {
+    if (skipped.has(name)) continue;
+    const fn = (clang as any)[name] as (value: any) => any;
+    const args = values[type];
+    benchmarks[name] = (i) => fn(args[i]);
+  }
+  if (Object.keys(benchmarks).length === 0) throw new Error(`No bindings found in ${declarationsPath}`);
+
+  const loop = (fn: (i: number) => any, count: number) => {
+    for (let n = 0; n < count; n++) {
+      for (let i = 0; i < cursors.length; i++) {
+        release(fn(i));
+      }
+    }
+  };
+
+  const allocationCalls = allocationIterations * cursors.length;
+  // Allocations of the loop itself.
+  const loopAllocations = await countAllocations(() => loop(() => 0, allocationIterations));
+
+  const results: Record<string, { nsPerCall: number, jsAllocationsPerCall: number, wasmBytesPerCall: number }> = {};
+  for (const [name, fn] of Object.entries(benchmarks)) {
+    loop(fn, 10);
+
+    const wasmHeapBefore = clang.getHeapStats().inUseBytes;
+    const allocations = await countAllocations(() => loop(fn, allocationIterations));
+    const wasmBytes = clang.getHeapStats().inUseBytes - wasmHeapBefore;
+
+    gc();
+    const start = process.hrtime.bigint();
+    loop(fn, iterations);
+    const ns = Number(process.hrtime.bigint() - start);
+
+    results[name] = {
+      nsPerCall: ns / (iterations * cursors.length),
+      jsAllocationsPerCall: Math.max(0, allocations - loopAllocations) / allocationCalls,
+      wasmBytesPerCall: wasmBytes / allocationCalls,
+    };
+  }
+
+  const native: Record<string, number> | undefined = fs.existsSync(nativeResultsPath)
+    ? JSON.parse(fs.readFileSync(nativeResultsPath, "utf8")).nsPerCall
+    : undefined;
+  const baseline: typeof results | undefined = baselinePath
+    ? JSON.parse(fs.readFileSync(baselinePath, "utf8")).results
+    : undefined;
+  console.log(`${Object.keys(results).length} bindings, ${cursors.length} cursors${native ? "" : ", run native/build.ts for the native baseline"}`);
+  console.table(Object.fromEntries(Object.entries(results).map(([name, r]) => [name, {
+    "ns / call": r.nsPerCall.toFixed(0),
+    ...(native ? {
+      "native ns / call": native[name]?.toFixed(0) ?? "-",
+      "overhead": native[name] ? (r.nsPerCall / native[name]).toFixed(1) : "-",
+    } : {}),
+    "JS allocations / call": r.jsAllocationsPerCall.toFixed(1),
+    "wasm bytes / call": r.wasmBytesPerCall.toFixed(0),
+    ...(baseline?.[name] ? {
+      "baseline ns / call": baseline[name].nsPerCall.toFixed(0),
+      "speedup": (baseline[name].nsPerCall / r.nsPerCall).toFixed(2),
+    } : {}),
+  }])));
+  fs.writeFileSync(resultsPath, JSON.stringify({ cursors: cursors.length, native, results }, null, 2));
+
+  session.disconnect();
+  clang.disposeTranslationUnit(tu);
+  clang.disposeIndex(index);
+  clang.PThread.terminateAllThreads();
+};
+
+run();
@@ -0,0 +1,37 @@
+import { exec } from "shelljs";
+import path from "path";
+import fs from "fs";
+
+// Builds native/main.cpp against libclangjs-cmake, like tests/test-cmake, and
+// writes the native time per call to microbench-native.json for microbench.ts.
+
+const buildPath = path.join(__dirname, "build");
+const resultsPath = path.join(__dirname, "..", "microbench-native.json");
+
+const configureAndRunBuild = () => {
+  {
+    fs.rmSync(buildPath, { recursive: true, force: true });
+    fs.mkdirSync(buildPath, { recursive: true });
+    fs.cpSync(path.join(__dirname, "..", "node_modules", "libclangjs-cmake"), path.join(buildPath, "libclangjs-cmake"), { recursive: true });
+  }
+  {
+    // Configure
+    const res = exec(`emcmake cmake .. ${[
+      `-Dlibclangjs-cmake_DIR="${path.join(buildPath, "libclangjs-cmake")}"`,
+    ].join(" ")}`, { cwd: buildPath });
+    if (res.code !== 0) throw new Error(res.stderr);
+  }
+  {
+    // Run build
+    const res = exec("cmake --build .", { cwd: buildPath });
+    if (res.code !== 0) throw new Error(res.stderr);
+  }
+  {
+    // Run executable
+    const res = exec("node microbench-native.js", { cwd: buildPath, silent: true });
+    if (res.code !== 0) throw new Error(res.stderr);
+    fs.writeFileSync(resultsPath, res.stdout);
+  }
+};
+
+configureAndRunBuild();
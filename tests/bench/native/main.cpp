@@ -0,0 +1,105 @@
+#include <chrono>
+#include <clang-c/Index.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Calls a subset of the libclang accessors timed by microbench.ts directly,
+// over the same cursors and types, and prints the time per call in nanoseconds
+// as JSON. The subset covers the accessors traversals call most, each kind of
+// result (enum, struct and string) and the types. Like microbench.ts, each
+// benchmark is warmed up before it is timed.
+
+const unsigned warmupIterations = 10;
+const unsigned iterations = 200;
+
+template <typename T, typename F>
+double measure(const std::vector<T> &values, F &&fn) {
+  unsigned sink = 0;
+  auto loop = [&](unsigned count) {
+    for (unsigned i = 0; i < count; i++) {
+      for (const T &value : values) {
+        sink += fn(value);
+      }
+    }
+  };
+  loop(warmupIterations);
+  auto start = std::chrono::steady_clock::now();
+  loop(iterations);
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  // Keeps the calls from being optimized away.
+  if (sink == 0xdeadbeef) {
+    std::cerr << sink;
+  }
+  return elapsed.count() / (iterations * values.size());
+}
+
+unsigned disposeString(CXString str) {
+  unsigned ret = clang_getCString(str) != nullptr;
+  clang_disposeString(str);
+  return ret;
+}
+
+int main() {
+  CXIndex index = clang_createIndex(0, 0);
+  CXTranslationUnit tu = clang_parseTranslationUnit(
+      index, "/microbench.cpp", nullptr, 0, nullptr, 0, 0);
+  if (tu == nullptr) {
+    std::cerr << "Cannot parse /microbench.cpp" << std::endl;
+    return 1;
+  }
+  std::vector<CXCursor> cursors;
+  clang_visitChildren(
+      clang_getTranslationUnitCursor(tu),
+      [](CXCursor cursor, CXCursor, CXClientData data) {
+        static_cast<std::vector<CXCursor> *>(data)->push_back(cursor);
+        return CXChildVisit_Recurse;
+      },
+      &cursors);
+  std::vector<CXType> types;
+  for (const CXCursor &cursor : cursors) {
+    types.push_back(clang_getCursorType(cursor));
+  }
+
+  std::vector<std::pair<std::string, double>> results = {
+      {"getCursorKind", measure(cursors, [](CXCursor c) {
+         return static_cast<unsigned>(clang_getCursorKind(c));
+       })},
+      {"getCursorLocation", measure(cursors, [](CXCursor c) {
+         return clang_getCursorLocation(c).int_data;
+       })},
+      {"getCursorExtent", measure(cursors, [](CXCursor c) {
+         return clang_getCursorExtent(c).end_int_data;
+       })},
+      {"getCursorType", measure(cursors, [](CXCursor c) {
+         return static_cast<unsigned>(clang_getCursorType(c).kind);
+       })},
+      {"getCursorSemanticParent", measure(cursors, [](CXCursor c) {
+         return static_cast<unsigned>(clang_getCursorSemanticParent(c).kind);
+       })},
+      {"hashCursor", measure(cursors, [](CXCursor c) {
+         return clang_hashCursor(c);
+       })},
+      {"getCursorSpelling", measure(cursors, [](CXCursor c) {
+         return disposeString(clang_getCursorSpelling(c));
+       })},
+      {"getCursorUSR", measure(cursors, [](CXCursor c) {
+         return disposeString(clang_getCursorUSR(c));
+       })},
+      {"getTypeSpelling", measure(types, [](CXType t) {
+         return disposeString(clang_getTypeSpelling(t));
+       })},
+  };
+
+  std::cout << "{\"cursors\": " << cursors.size() << ", \"nsPerCall\": {";
+  for (size_t i = 0; i < results.size(); i++) {
+    std::cout << (i == 0 ? "" : ", ") << "\"" << results[i].first
+              << "\": " << results[i].second;
+  }
+  std::cout << "}}" << std::endl;
+
+  clang_disposeTranslationUnit(tu);
+  clang_disposeIndex(index);
+  return 0;
+}
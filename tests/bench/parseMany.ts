@@ -0,0 +1,51 @@
+import os from "os";
+import { initClang, cwd, mountStandardLibrary } from "./common";
+
+const fileCount = 64;
+
+// Parses a synthetic project sequentially and with parseMany using an
+// increasing number of threads.
+const run = async () => {
+  const clang = await initClang();
+  const args = mountStandardLibrary(clang);
+  const headers = ["<vector>", "<string>", "<map>", "<memory>", "<algorithm>"];
+  const files = Array.from({ length: fileCount }, (_, i) => {
+    const fileName = `${cwd}/file${i}.cpp`;
+    clang.FS.writeFile(fileName, [
+      `#include ${headers[i % headers.length]}`,
+      `int function${i}() { return ${i}; }`,
+    ].join("\n"));
+    return fileName;
+  });
+  const index = clang.createIndex(0, 0);
+
+  const start = performance.now();
+  for (const file of files) {
+    clang.disposeTranslationUnit(clang.parseTranslationUnit(index, file, args, null, 0));
+  }
+  const sequential = performance.now() - start;
+
+  const results: Record<string, { "ms": string, "files / s": string, "speedup": string }> = {};
+  results["sequential"] = { "ms": sequential.toFixed(0), "files / s": (fileCount * 1000 / sequential).toFixed(1), "speedup": "1.0" };
+  // parseMany uses at most one worker per two pool threads, leaving one thread
+  // for parses on the main thread.
+  const maxThreads = Math.max(1, Math.floor((os.cpus().length - 1) / 2));
+  for (let threads = 1; threads <= maxThreads; threads *= 2) {
+    const start = performance.now();
+    const tus = await clang.parseMany(index, files.map((file) => ({ file, args })), { threads });
+    const ms = performance.now() - start;
+    for (const { tu, errorCode } of tus) {
+      if (errorCode !== clang.CXErrorCode.Success.value) throw new Error(`Cannot parse: ${errorCode}`);
+      clang.disposeTranslationUnit(tu);
+    }
+    results[`parseMany, ${threads} threads`] = { "ms": ms.toFixed(0), "files / s": (fileCount * 1000 / ms).toFixed(1), "speedup": (sequential / ms).toFixed(1) };
+  }
+
+  console.log(`${fileCount} files, ${os.cpus().length} cores`);
+  console.table(results);
+
+  clang.disposeIndex(index);
+  clang.PThread.terminateAllThreads();
+};
+
+run();
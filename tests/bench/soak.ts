@@ -0,0 +1,121 @@
+import { initClang, cwd } from "./common";
+
+// Loops parse -> visit -> reparse -> dispose and samples the wasm heap in use,
+// the number of live emval handles and the number of live pointer handles
+// (embind class instances such as CXTranslationUnit). Fails if any grows by
+// more than a threshold per iteration, fitted over all samples after the
+// warmup.
+//
+// Each iteration passes many long arguments and a large unsaved file, so a
+// leak in their marshalling adds kilobytes per iteration. Handles are dropped
+// without delete(), as typical callers do. Before each sample a garbage
+// collection runs, so handles freed by their finalizers are not counted.
+// Must be run with --expose-gc:
+//
+//   node --expose-gc -r ts-node/register soak.ts [--iterations 2000]
+//        [--max-heap-slope 64] [--max-handle-slope 0.01]
+
+const option = (name: string, fallback: number) => {
+  const i = process.argv.indexOf(`--${name}`);
+  return i === -1 ? fallback : Number(process.argv[i + 1]);
+};
+const iterations = option("iterations", 2000);
+const warmup = Math.min(100, Math.floor(iterations / 10));
+const sampleInterval = 10;
+// Bytes per iteration.
+const maxHeapSlope = option("max-heap-slope", 64);
+// Handles per iteration.
+const maxHandleSlope = option("max-handle-slope", 0.01);
+
+const gc = (global as any).gc as (() => void) | undefined;
+if (gc === undefined) throw new Error("Run with --expose-gc");
+
+// Returns the slope of the least squares line through the samples.
+const slope = (samples: [number, number][]) => {
+  const n = samples.length;
+  const meanX = samples.reduce((sum, [x]) => sum + x, 0) / n;
+  const meanY = samples.reduce((sum, [, y]) => sum + y, 0) / n;
+  let covariance = 0;
+  let variance = 0;
+  for (const [x, y] of samples) {
+    covariance += (x - meanX) * (y - meanY);
+    variance += (x - meanX) ** 2;
+  }
+  return variance === 0 ? 0 : covariance / variance;
+};
+
+const run = async () => {
+  const clang = await initClang();
+  const fileName = `${cwd}/soak.cpp`;
+  const padding = "// padding\n".repeat(6000);
+  const source = (i: number) => [
+    "#define SOAK_ITERATION " + i,
+    "struct Soak { int value; int twice() const { return value * 2; } };",
+    "template <typename T> T identity(T t) { return t; }",
+    `int soak${i % 7}() { Soak s{SOAK_ITERATION}; return identity(s.twice()); }`,
+    padding,
+  ].join("\n");
+  const args = [
+    "-std=c++17",
+    ...Array.from({ length: 64 }, (_, i) => `-DSOME_RATHER_LONG_MACRO_NAME_${i}=${"x".repeat(64)}`),
+  ];
+  const index = clang.createIndex(0, 0);
+
+  const heapSamples: [number, number][] = [];
+  const handleSamples: [number, number][] = [];
+  const pointerSamples: [number, number][] = [];
+  for (let i = 0; i < iterations; i++) {
+    const tu = clang.parseTranslationUnit(index, fileName, args, [{ filename: fileName, contents: source(i) }], clang.defaultEditingTranslationUnitOptions());
+    if (clang.isNullPointer(tu)) throw new Error(`Cannot parse in iteration ${i}`);
+    let spellings = 0;
+    clang.visitChildren(clang.getTranslationUnitCursor(tu), (c) => {
+      spellings += clang.getCursorSpelling(c)?.length ?? 0;
+      clang.getCursorLocation(c);
+      clang.getCursorType(c);
+      return clang.CXChildVisitResult.Recurse;
+    });
+    if (spellings === 0) throw new Error(`No cursors in iteration ${i}`);
+    if (clang.reparseTranslationUnit(tu, [{ filename: fileName, contents: source(i + 1) }], clang.defaultReparseOptions(tu)) !== 0) {
+      throw new Error(`Cannot reparse in iteration ${i}`);
+    }
+    clang.disposeTranslationUnit(tu);
+
+    if (i >= warmup && i % sampleInterval === 0) {
+      gc();
+      // Finalizers run in a later task.
+      await new Promise((resolve) => setImmediate(resolve));
+      heapSamples.push([i, clang.getHeapStats().inUseBytes]);
+      handleSamples.push([i, clang.count_emval_handles()]);
+      pointerSamples.push([i, clang.countLivePointers()]);
+    }
+  }
+  clang.disposeIndex(index);
+  if (heapSamples.length < 2) throw new Error(`Too few iterations to sample after a warmup of ${warmup}`);
+
+  const heapSlope = slope(heapSamples);
+  const handleSlope = slope(handleSamples);
+  const pointerSlope = slope(pointerSamples);
+  console.log(`${iterations} iterations`);
+  console.table({
+    "heap in use": {
+      "first": heapSamples[0][1], "last": heapSamples[heapSamples.length - 1][1],
+      "growth / iteration": heapSlope.toFixed(1), "limit": maxHeapSlope,
+    },
+    "emval handles": {
+      "first": handleSamples[0][1], "last": handleSamples[handleSamples.length - 1][1],
+      "growth / iteration": handleSlope.toFixed(3), "limit": maxHandleSlope,
+    },
+    "pointer handles": {
+      "first": pointerSamples[0][1], "last": pointerSamples[pointerSamples.length - 1][1],
+      "growth / iteration": pointerSlope.toFixed(3), "limit": maxHandleSlope,
+    },
+  });
+  clang.PThread.terminateAllThreads();
+
+  if (heapSlope > maxHeapSlope || handleSlope > maxHandleSlope || pointerSlope > maxHandleSlope) {
+    console.error("Memory grows with every iteration");
+    process.exitCode = 1;
+  }
+};
+
+run();
@@ -0,0 +1,215 @@
+import fs from "fs";
+import path from "path";
+import { LibClang } from "libclangjs/libclangjs";
+import { initClang, cwd, measure, mountStandardLibrary, mountStdlibPch } from "./common";
+
+// Runs the main stages of a libclangjs session over a corpus of translation
+// units and reports the median wall time of each stage and the size of the
+// wasm heap after it. The heap never shrinks, so that size is the high-water
+// mark of the session up to the end of the stage, not of the stage alone.
+// Results are written as JSON and compared against a stored baseline.
+//
+//   ts-node suite.ts [--output results.json] [--baseline baseline.json]
+//                    [--update-baseline] [--threshold 0.25]
+
+type StageResult = { ms: number, heapSizeAfter: number };
+type SuiteResult = {
+  emscriptenHeapMax: number,
+  init: StageResult,
+  corpus: Record<string, Record<string, StageResult>>,
+};
+
+const option = (name: string, fallback: string) => {
+  const i = process.argv.indexOf(`--${name}`);
+  return i === -1 ? fallback : process.argv[i + 1];
+};
+const outputPath = path.resolve(option("output", "suite-results.json"));
+const baselinePath = path.resolve(option("baseline", path.join(__dirname, "suite-baseline.json")));
+const threshold = Number(option("threshold", "0.25"));
+const iterations = 5;
+
+const smallSource = () => [
+  "struct Point { int x; int y; };",
+  "int dot(Point a, Point b) { return a.x * b.x + a.y * b.y; }",
+  "int main() { return dot({1, 2}, {3, 4}); }",
+].join("\n");
+
+const mediumSource = () => Array.from({ length: 200 }, (_, i) => [
+  `class Shape${i} {`,
+  "public:",
+  `  explicit Shape${i}(int size) : size(size) {}`,
+  `  int area() const { int a = 0; for (int k = 0; k < size; k++) { a += k * ${i}; } return a; }`,
+  "private:",
+  "  int size;",
+  "};",
+  `int useShape${i}() { return Shape${i}(${i}).area(); }`,
+].join("\n")).join("\n");
+
+const stlSource = () => [
+  "#include <algorithm>",
+  "#include <map>",
+  "#include <memory>",
+  "#include <string>",
+  "#include <unordered_map>",
+  "#include <vector>",
+  "std::map<std::string, std::vector<int>> group(const std::vector<std::string> &keys) {",
+  "  std::map<std::string, std::vector<int>> groups;",
+  "  for (size_t i = 0; i < keys.size(); i++) { groups[keys[i]].push_back(static_cast<int>(i)); }",
+  "  return groups;",
+  "}",
+  "int count(const std::unordered_map<int, std::unique_ptr<int>> &m) {",
+  "  return std::count_if(m.begin(), m.end(), [](const auto &e) { return *e.second > 0; });",
+  "}",
+].join("\n");
+
+// Its preamble only includes headers of the c++17 standard library bundle.
+const coldParseSource = () => [
+  "#include <string>",
+  "#include <vector>",
+  "std::vector<std::string> split(const std::string &s, char separator) {",
+  "  std::vector<std::string> parts(1);",
+  "  for (char c : s) { if (c == separator) { parts.emplace_back(); } else { parts.back() += c; } }",
+  "  return parts;",
+  "}",
+].join("\n");
+
+const stage = (clang: LibClang, fn: () => void): StageResult => ({
+  ms: measure(fn, iterations),
+  heapSizeAfter: clang.getHeapStats().heapSize,
+});
+
+const runCorpusEntry = (clang: LibClang, name: string, source: string, args: string[]) => {
+  const fileName = `${cwd}/${name}.cpp`;
+  const astFileName = `${cwd}/${name}.ast`;
+  clang.FS.writeFile(fileName, source);
+  const index = clang.createIndex(0, 0);
+  const parse = () => {
+    const tu = clang.parseTranslationUnit(index, fileName, args, null, clang.defaultEditingTranslationUnitOptions());
+    if (clang.isNullPointer(tu)) throw new Error(`Cannot parse ${name}`);
+    return tu;
+  };
+
+  const results: Record<string, StageResult> = {};
+  results.parse = stage(clang, () => clang.disposeTranslationUnit(parse()));
+
+  const tu = parse();
+  const cursor = clang.getTranslationUnitCursor(tu);
+  results.visitChildren = stage(clang, () => {
+    clang.visitChildren(cursor, () => clang.CXChildVisitResult.Recurse);
+  });
+  results.tokenize = stage(clang, () => {
+    clang.tokenizeRange(tu, clang.getCursorExtent(cursor), false);
+  });
+  let edit = 0;
+  results.reparse = stage(clang, () => {
+    const contents = `${source}\nint edit${edit++} = 0;\n`;
+    const ret = clang.reparseTranslationUnit(tu, [{ filename: fileName, contents }], clang.defaultReparseOptions(tu));
+    if (ret !== 0) throw new Error(`Cannot reparse ${name}`);
+  });
+  results.saveLoad = stage(clang, () => {
+    if (clang.saveTranslationUnit(tu, astFileName, clang.defaultSaveOptions(tu)) !== clang.CXSaveError.None.value) {
+      throw new Error(`Cannot save ${name}`);
+    }
+    const loaded = clang.createTranslationUnit(index, astFileName);
+    if (clang.isNullPointer(loaded)) throw new Error(`Cannot load ${name}`);
+    clang.disposeTranslationUnit(loaded);
+  });
+
+  clang.FS.unlink(astFileName);
+  clang.disposeTranslationUnit(tu);
+  clang.disposeIndex(index);
+  return results;
+};
+
+// Parses a source file including standard library headers with a new index
+// each time, without and, if they have been built, with the standard library
+// PCH bundles.
+const runColdParse = (clang: LibClang, args: string[], manifestPath?: string) => {
+  const fileName = `${cwd}/coldParse.cpp`;
+  clang.FS.writeFile(fileName, coldParseSource());
+  const coldParse = (withPchBundle: boolean) => () => {
+    const index = clang.createIndex(0, 0);
+    if (withPchBundle && !clang.CXIndex_setPchBundle(index, manifestPath!)) {
+      throw new Error(`Cannot load ${manifestPath}`);
+    }
+    const tu = clang.parseTranslationUnit(index, fileName, args, null, 0);
+    if (clang.isNullPointer(tu)) throw new Error("Cannot parse coldParse.cpp");
+    clang.disposeTranslationUnit(tu);
+    clang.disposeIndex(index);
+  };
+
+  const results: Record<string, StageResult> = {};
+  results.parse = stage(clang, coldParse(false));
+  if (manifestPath === undefined) {
+    console.log("No standard library PCH bundles, build libclangjs to add the PCH stage");
+  } else {
+    results.parseWithPchBundle = stage(clang, coldParse(true));
+  }
+  return results;
+};
+
+// Returns a line for each stage which got slower or grew the heap by more than
+// the threshold.
+const compare = (result: SuiteResult, baseline: SuiteResult) => {
+  const regressions: string[] = [];
+  const check = (name: string, current: StageResult, previous?: StageResult) => {
+    if (previous === undefined) return;
+    if (current.ms > previous.ms * (1 + threshold)) {
+      regressions.push(`${name}: ${previous.ms.toFixed(1)} ms -> ${current.ms.toFixed(1)} ms`);
+    }
+    if (current.heapSizeAfter > previous.heapSizeAfter * (1 + threshold)) {
+      regressions.push(`${name}: heap size ${previous.heapSizeAfter} B -> ${current.heapSizeAfter} B`);
+    }
+  };
+  check("init", result.init, baseline.init);
+  for (const [entry, stages] of Object.entries(result.corpus)) {
+    for (const [name, current] of Object.entries(stages)) {
+      check(`${entry} ${name}`, current, baseline.corpus[entry]?.[name]);
+    }
+  }
+  return regressions;
+};
+
+const run = async () => {
+  const initStart = performance.now();
+  const clang = await initClang();
+  const init = { ms: performance.now() - initStart, heapSizeAfter: clang.getHeapStats().heapSize };
+  const args = mountStandardLibrary(clang);
+
+  const result: SuiteResult = {
+    emscriptenHeapMax: clang.getHeapStats().heapMax,
+    init,
+    corpus: {
+      small: runCorpusEntry(clang, "small", smallSource(), args),
+      medium: runCorpusEntry(clang, "medium", mediumSource(), args),
+      stl: runCorpusEntry(clang, "stl", stlSource(), args),
+      coldParse: runColdParse(clang, args, mountStdlibPch(clang)),
+    },
+  };
+  clang.PThread.terminateAllThreads();
+
+  console.table(Object.fromEntries(Object.entries(result.corpus).flatMap(([entry, stages]) =>
+    Object.entries(stages).map(([name, { ms, heapSizeAfter }]) => [`${entry} ${name}`, {
+      "median ms": ms.toFixed(1),
+      "heap size after, MB": (heapSizeAfter / 2 ** 20).toFixed(0),
+    }]))));
+  fs.writeFileSync(outputPath, JSON.stringify(result, null, 2));
+  console.log(`Results written to ${outputPath}`);
+
+  if (process.argv.includes("--update-baseline")) {
+    fs.writeFileSync(baselinePath, JSON.stringify(result, null, 2));
+    console.log(`Baseline written to ${baselinePath}`);
+  } else if (fs.existsSync(baselinePath)) {
+    const regressions = compare(result, JSON.parse(fs.readFileSync(baselinePath, "utf8")));
+    if (regressions.length > 0) {
+      console.error(`Regressions beyond ${threshold * 100}% against ${baselinePath}:\n${regressions.join("\n")}`);
+      process.exitCode = 1;
+    } else {
+      console.log(`No regressions beyond ${threshold * 100}% against ${baselinePath}`);
+    }
+  } else {
+    console.log(`No baseline at ${baselinePath}, run with --update-baseline to store one`);
+  }
+};
+
+run();
@@ -0,0 +1,50 @@
+import { initClang, cwd, measure, mountStandardLibrary } from "./common";
+
+// Compares the per-cursor visitChildren callback with the batched visitor and
+// the bulk export on the AST of a large standard library header.
+const run = async () => {
+  const clang = await initClang();
+  const args = mountStandardLibrary(clang);
+  const fileName = `${cwd}/vector.cpp`;
+  clang.FS.writeFile(fileName, "#include <vector>\n");
+
+  const index = clang.createIndex(0, 0);
+  const tu = clang.parseTranslationUnit(index, fileName, args, null, 0);
+  if (clang.isNullPointer(tu)) throw new Error("Cannot parse <vector>");
+  const cursor = clang.getTranslationUnitCursor(tu);
+
+  let nodes = 0;
+  const results = {
+    visitChildren: measure(() => {
+      nodes = 0;
+      clang.visitChildren(cursor, () => {
+        nodes++;
+        return clang.CXChildVisitResult.Recurse;
+      });
+    }),
+    visitChildrenBatched: measure(() => {
+      let batchedNodes = 0;
+      clang.visitChildrenBatched(cursor, (cursors) => {
+        batchedNodes += cursors.length;
+      });
+      if (batchedNodes !== nodes) throw new Error(`Batched visitor saw ${batchedNodes} instead of ${nodes} cursors`);
+    }),
+    exportCursorTree: measure(() => {
+      const tree = clang.exportCursorTree(cursor, clang.CursorTreeField.All.value);
+      if (tree.length !== nodes) throw new Error(`Export contains ${tree.length} instead of ${nodes} cursors`);
+    }),
+  };
+
+  console.log(`<vector>: ${nodes} cursors`);
+  console.table(Object.fromEntries(Object.entries(results).map(([name, ms]) => [name, {
+    "median ms": ms.toFixed(1),
+    "ns / cursor": (ms * 1e6 / nodes).toFixed(0),
+    "speedup": (results.visitChildren / ms).toFixed(1),
+  }])));
+
+  clang.disposeTranslationUnit(tu);
+  clang.disposeIndex(index);
+  clang.PThread.terminateAllThreads();
+};
+
+run();
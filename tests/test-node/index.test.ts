@@ -1,5 +1,5 @@
 import init from "libclangjs/node";
-import { CXCursor, CXFile, CXIndex, CXTranslationUnit, LibClang } from "libclangjs/libclangjs";
+import { CXCursor, CXFile, CXIndex, CXTranslationUnit, IndexEvents, LibClang } from "libclangjs/libclangjs";
 import path from "path";
 import fs from "fs";
 
@@ -45,6 +45,105 @@ test(`Call "parseTranslationUnit"`, async () => {
   expect(foundCookie).toBeTruthy();
 });
 
+const diagnostics = (tu: CXTranslationUnit) => Array.from({ length: clang.getNumDiagnostics(tu) }, (_, i) => {
+  const diagnostic = clang.getDiagnostic(tu, i);
+  const spelling = clang.getDiagnosticSpelling(diagnostic);
+  clang.disposeDiagnostic(diagnostic);
+  return spelling;
+});
+
+// Parses with the given index and checks that the diagnostics match those of
+// a parse without precompiled headers.
+const parseLikePlain = (cachedIndex: CXIndex, file: string, args: string[]) => {
+  const plainIndex = clang.createIndex(0, 0);
+  const plainTu = clang.parseTranslationUnit(plainIndex, file, args, null, 0);
+  const cachedTu = clang.parseTranslationUnit(cachedIndex, file, args, null, 0);
+  expect(clang.isNullPointer(cachedTu)).toBeFalsy();
+  expect(diagnostics(cachedTu)).toEqual(diagnostics(plainTu));
+  clang.disposeTranslationUnit(plainTu);
+  clang.disposeIndex(plainIndex);
+  return cachedTu;
+};
+
+const hasCookie = (tu: CXTranslationUnit) => {
+  let foundCookie = false;
+  clang.visitChildren(clang.getTranslationUnitCursor(tu), (c) => {
+    foundCookie ||= clang.getCursorSpelling(c) === "cookie";
+    return clang.CXChildVisitResult.Continue;
+  });
+  return foundCookie;
+};
+
+test("Can keep precompiled preambles in a directory", () => {
+  const pchDir = path.join("testSrc", "pch");
+  fs.rmSync(pchDir, { recursive: true, force: true });
+  fs.mkdirSync(pchDir);
+  fs.writeFileSync(path.join("testSrc", "guarded.hpp"), "#pragma once\nint guarded();\n");
+  fs.writeFileSync(path.join("testSrc", "guarded.cpp"), `#include "guarded.hpp"\nint useGuarded() { return guarded(); }\n`);
+  const cachedIndex = clang.createIndex(0, 0);
+  clang.CXIndex_setPreambleCacheDirectory(cachedIndex, path.join(cwd, "pch"));
+  const pchFiles = () => fs.readdirSync(pchDir).filter((f) => f.endsWith(".pch")).length;
+  for (let i = 0; i < 2; i++) {
+    const cachedTu = parseLikePlain(cachedIndex, path.join(cwd, "guarded.cpp"), []);
+    expect(diagnostics(cachedTu)).toEqual([]);
+    clang.disposeTranslationUnit(cachedTu);
+    expect(pchFiles()).toBe(1);
+  }
+  // The headers of main.cpp have no include guards, so its preamble is not
+  // precompiled.
+  const unguardedTu = parseLikePlain(cachedIndex, path.join(cwd, "main.cpp"), [`-I${path.join(cwd, "dir")}`]);
+  expect(hasCookie(unguardedTu)).toBe(true);
+  clang.disposeTranslationUnit(unguardedTu);
+  expect(pchFiles()).toBe(1);
+  clang.disposeIndex(cachedIndex);
+  fs.rmSync(pchDir, { recursive: true });
+  for (const file of ["guarded.hpp", "guarded.cpp"]) {
+    fs.rmSync(path.join("testSrc", file));
+  }
+});
+
+test("Can parse with a PCH bundle", () => {
+  const bundleIndex = clang.createIndex(0, 0);
+  expect(clang.CXIndex_setPchBundle(bundleIndex, path.join(cwd, "missing", "manifest.json"))).toBe(false);
+  fs.writeFileSync(path.join("testSrc", "manifest.json"), "{ not json");
+  expect(clang.CXIndex_setPchBundle(bundleIndex, path.join(cwd, "manifest.json"))).toBe(false);
+  fs.writeFileSync(path.join("testSrc", "manifest.json"), JSON.stringify({ bundles: [{ file: 1 }] }));
+  expect(clang.CXIndex_setPchBundle(bundleIndex, path.join(cwd, "manifest.json"))).toBe(false);
+
+  const args = [`-I${path.join(cwd, "dir")}`];
+  const buildBundle = (name: string, headers: string[]) => {
+    const tu = clang.parseTranslationUnit(bundleIndex, path.join(cwd, `${name}.hpp`), args,
+      [{ filename: path.join(cwd, `${name}.hpp`), contents: headers.map((h) => `#include ${h}\n`).join("") }],
+      clang.CXTranslationUnit_Flags.Incomplete.value | clang.CXTranslationUnit_Flags.ForSerialization.value);
+    expect(clang.saveTranslationUnit(tu, path.join(cwd, `${name}.pch`), 0)).toBe(clang.CXSaveError.None.value);
+    clang.disposeTranslationUnit(tu);
+    return { name, file: `${name}.pch`, headers, args };
+  };
+  fs.writeFileSync(path.join("testSrc", "guarded.hpp"), "#pragma once\nint guarded();\n");
+  fs.writeFileSync(path.join("testSrc", "guarded.cpp"), `#include "guarded.hpp"\nint useGuarded() { return guarded(); }\n`);
+  fs.writeFileSync(path.join("testSrc", "manifest.json"), JSON.stringify({
+    bundles: [
+      buildBundle("guarded", ['"guarded.hpp"']),
+      // Including these headers again redefines their declarations, so parses
+      // with this bundle are discarded.
+      buildBundle("unguarded", ['"anotherHeader.hpp"', '"header.hpp"']),
+    ],
+  }));
+  expect(clang.CXIndex_setPchBundle(bundleIndex, path.join(cwd, "manifest.json"))).toBe(true);
+
+  const guardedTu = parseLikePlain(bundleIndex, path.join(cwd, "guarded.cpp"), args);
+  expect(diagnostics(guardedTu)).toEqual([]);
+  clang.disposeTranslationUnit(guardedTu);
+  const unguardedTu = parseLikePlain(bundleIndex, path.join(cwd, "main.cpp"), args);
+  expect(hasCookie(unguardedTu)).toBe(true);
+  clang.disposeTranslationUnit(unguardedTu);
+  expect(clang.CXIndex_setPchBundle(bundleIndex, null)).toBe(true);
+  clang.disposeIndex(bundleIndex);
+  for (const file of ["guarded.hpp", "guarded.cpp", "guarded.pch", "unguarded.pch", "manifest.json"]) {
+    fs.rmSync(path.join("testSrc", file));
+  }
+});
+
 let mainFile: CXFile;
 
 test("Can get file contents", () => {
@@ -137,6 +236,184 @@ test("Can correctly traverse identify C++ code", () => {
   expect(allFound).toBe(true);
 });
 
+test("Can export the cursor tree into typed arrays", () => {
+  const cursor = clang.getTranslationUnitCursor(tu);
+  const visited: { kind: number, spelling: string, depth: number }[] = [];
+  const depths = new Map<number, number>();
+  clang.visitChildren(cursor, (child, parent) => {
+    const depth = (depths.get(clang.hashCursor(parent)) ?? 0) + 1;
+    depths.set(clang.hashCursor(child), depth);
+    visited.push({ kind: clang.getCursorKind(child).value, spelling: clang.getCursorSpelling(child), depth });
+    return clang.CXChildVisitResult.Recurse;
+  });
+
+  const tree = clang.exportCursorTree(cursor, clang.CursorTreeField.All.value);
+  expect(tree.length).toBe(visited.length);
+  for (let i = 0; i < tree.length; i++) {
+    expect(tree.kind![i]).toBe(visited[i].kind);
+    expect(tree.strings![tree.spelling![i]]).toBe(visited[i].spelling);
+    expect(tree.depth![i]).toBe(visited[i].depth);
+    const parent = tree.parent![i];
+    expect(parent === -1 ? 1 : tree.depth![parent] + 1).toBe(tree.depth![i]);
+    expect(tree.startOffset![i]).toBeLessThanOrEqual(tree.endOffset![i]);
+  }
+  expect(tree.files).toContain("home/web_user/main.cpp");
+
+  const kindsOnly = clang.exportCursorTree(cursor, clang.CursorTreeField.Kind.value);
+  expect(kindsOnly.kind).toEqual(tree.kind);
+  expect(kindsOnly.parent).toBeUndefined();
+});
+
+test("Can visit filtered children", () => {
+  const cursor = clang.getTranslationUnitCursor(tu);
+  const functions: string[] = [];
+  clang.visitChildrenFiltered(cursor, {
+    kinds: [clang.CXCursorKind.FunctionDecl, clang.CXCursorKind.CXXMethod, clang.CXCursorKind.Constructor],
+    mainFileOnly: true,
+  }, (child, parent) => {
+    expect(clang.Location_isFromMainFile(clang.getCursorLocation(child))).toBeTruthy();
+    functions.push(clang.getCursorSpelling(child)!);
+    return clang.CXChildVisitResult.Continue;
+  });
+  expect(functions).toEqual(["main", "TestClass", "Something"]);
+
+  let count = 0;
+  const broken = clang.visitChildrenFiltered(cursor, { maxDepth: 1 }, (child, parent) => {
+    expect(clang.equalCursors(parent, cursor)).toBeTruthy();
+    count++;
+    return clang.CXChildVisitResult.Recurse;
+  });
+  expect(broken).toBe(0);
+  expect(count).toBeGreaterThan(0);
+
+  expect(clang.visitChildrenFiltered(cursor, null, () => clang.CXChildVisitResult.Break)).not.toBe(0);
+});
+
+test("Can visit children in batches", () => {
+  const cursor = clang.getTranslationUnitCursor(tu);
+  const expected: string[] = [];
+  clang.visitChildren(cursor, (child, parent) => {
+    expected.push(clang.getCursorSpelling(child)!);
+    return clang.CXChildVisitResult.Recurse;
+  });
+
+  const spellings: string[] = [];
+  let batches = 0;
+  clang.visitChildrenBatched(cursor, (cursors, parents) => {
+    expect(cursors.length).toBe(parents.length);
+    expect(cursors.length).toBeLessThanOrEqual(4);
+    batches++;
+    cursors.forEach(c => spellings.push(clang.getCursorSpelling(c)!));
+  }, 4);
+  expect(spellings.sort()).toEqual([...expected].sort());
+  expect(batches).toBeGreaterThan(1);
+
+  const topLevel: string[] = [];
+  const broken = clang.visitChildrenBatched(cursor, (cursors) => {
+    cursors.forEach(c => topLevel.push(clang.getCursorSpelling(c)!));
+    return cursors.map(() => clang.CXChildVisitResult.Continue.value);
+  });
+  expect(broken).toBe(0);
+  expect(topLevel).toContain("cookie");
+  expect(topLevel).not.toContain("i");
+
+  expect(clang.visitChildrenBatched(cursor, (cursors) => [clang.CXChildVisitResult.Break.value])).not.toBe(0);
+});
+
+test("Can tokenize a range", () => {
+  const range = clang.getRange(clang.getLocation(tu, mainFile, 4, 1), clang.getLocation(tu, mainFile, 4, 25));
+  const tokens = clang.tokenizeRange(tu, range, true);
+  const source = fs.readFileSync(path.join("testSrc", "main.cpp")).toString();
+  const spellings = Array.from(tokens.offset, (offset, i) => source.substring(offset, offset + tokens.length[i]));
+  expect(spellings).toEqual(["int", "main", "(", ")", "{", "return", "0", ";", "}"]);
+  expect(tokens.kind[0]).toBe(tokens.kind[5]);
+  expect(tokens.kind[0]).not.toBe(tokens.kind[1]);
+  expect(tokens.cursorKind?.[1]).toBe(clang.CXCursorKind.FunctionDecl.value);
+  expect(clang.tokenizeRange(tu, range, false).cursorKind).toBeUndefined();
+});
+
+test("Can index source files and translation units", () => {
+  const action = clang.IndexAction_create(index);
+  type Event = { kind: number, name: string, file: string, role: number };
+  const collect = (events: Event[]) => (batch: IndexEvents) => {
+    expect(batch.length).toBeLessThanOrEqual(4);
+    for (let i = 0; i < batch.length; i++) {
+      events.push({ kind: batch.kind[i], name: batch.strings[batch.name[i]], file: batch.files[batch.file[i]], role: batch.role[i] });
+    }
+  };
+  const fromSource: Event[] = [];
+  expect(clang.indexSourceFile(action, collect(fromSource), 0, path.join(cwd, "main.cpp"), [`-I${path.join(cwd, "dir")}`], null, 0, 4)).toBe(0);
+  const fromTu: Event[] = [];
+  expect(clang.indexTranslationUnit(action, collect(fromTu), 0, tu, 4)).toBe(0);
+  for (const events of [fromSource, fromTu]) {
+    const main = events.find((e) => e.name === "main");
+    expect(main?.kind).toBe(clang.IndexEventKind.Declaration.value);
+    expect(main?.file).toBe(path.join(cwd, "main.cpp"));
+    expect(main!.role & clang.CXSymbolRole.Definition.value).toBeTruthy();
+    expect(events.some((e) => e.name === "TestStruct" && e.kind === clang.IndexEventKind.Reference.value)).toBe(true);
+  }
+  clang.IndexAction_dispose(action);
+});
+
+test("Can index several files in one session", () => {
+  const session = clang.createIndexingSession(index);
+  const unsavedFiles = [
+    { filename: "shared.hpp", contents: "inline int shared() { return 0; }" },
+    { filename: "first.cpp", contents: `#include "shared.hpp"\nint first() { return shared(); }` },
+    { filename: "second.cpp", contents: `#include "shared.hpp"\nint second() { return shared(); }` },
+  ];
+  const names = (file: string) => {
+    const ret: string[] = [];
+    clang.IndexingSession_indexSourceFile(session, (batch) => {
+      for (let i = 0; i < batch.length; i++) {
+        if (batch.kind[i] === clang.IndexEventKind.Declaration.value) {
+          ret.push(batch.strings[batch.name[i]]);
+        }
+      }
+    }, 0, file, null, unsavedFiles, 0, null);
+    return ret;
+  };
+  expect(names("first.cpp")).toEqual(["shared", "first"]);
+  expect(names("second.cpp")).toEqual(["second"]);
+  unsavedFiles[1].contents = `#include "shared.hpp"\nint edited() { return shared(); }`;
+  expect(names("first.cpp")).toEqual(["edited"]);
+  const stats = clang.IndexingSession_getStats(session);
+  expect(stats.translationUnits).toBe(3);
+  expect(stats.indexedFiles).toBe(1);
+  expect(stats.skippedIncludes).toBe(2);
+  clang.disposeIndexingSession(session);
+});
+
+test("Can build, save and load a symbol index", () => {
+  const action = clang.IndexAction_create(index);
+  const symbolIndex = clang.createSymbolIndex();
+  expect(clang.SymbolIndex_updateFromTranslationUnit(symbolIndex, action, tu)).toBe(0);
+  const main = clang.SymbolIndex_lookup(symbolIndex, "c:@F@main#");
+  expect(main.length).toBe(1);
+  expect(main.strings[main.file[0]]).toBe(path.join(cwd, "main.cpp"));
+  expect(main.line[0]).toBe(4);
+  expect(main.role[0] & clang.CXSymbolRole.Definition.value).toBeTruthy();
+  const testClass = clang.SymbolIndex_lookupPrefix(symbolIndex, "c:@S@TestClass");
+  expect(testClass.length).toBeGreaterThan(1);
+  expect(clang.SymbolIndex_updateFromTranslationUnit(symbolIndex, action, tu)).toBe(0);
+  expect(clang.SymbolIndex_lookupPrefix(symbolIndex, "c:@S@TestClass").length).toBe(testClass.length);
+
+  const fileName = path.join(cwd, "symbols.idx");
+  expect(clang.SymbolIndex_save(symbolIndex, fileName)).toBe(true);
+  const loaded = clang.createSymbolIndex();
+  expect(clang.SymbolIndex_load(loaded, fileName)).toBe(true);
+  expect(clang.SymbolIndex_lookupPrefix(loaded, "c:@S@TestClass").length).toBe(testClass.length);
+  expect(clang.SymbolIndex_load(loaded, path.join(cwd, "main.cpp"))).toBe(false);
+  expect(clang.SymbolIndex_lookup(loaded, "c:@F@main#").length).toBe(1);
+  expect(clang.SymbolIndex_removeFile(loaded, path.join(cwd, "main.cpp"))).toBe(true);
+  expect(clang.SymbolIndex_lookup(loaded, "c:@F@main#").length).toBe(0);
+  fs.unlinkSync(path.join("testSrc", "symbols.idx"));
+
+  clang.disposeSymbolIndex(loaded);
+  clang.disposeSymbolIndex(symbolIndex);
+  clang.IndexAction_dispose(action);
+});
+
 test("Can get file names from cursors", () => {
   const cursor = clang.getTranslationUnitCursor(tu);
   clang.visitChildren(cursor, (child, parent) => {
@@ -175,6 +452,390 @@ test("Can handle unsaved files", () => {
   expect(clang.isNullPointer(tu)).toBeFalsy();
 });
 
+test("Can handle binary unsaved files", () => {
+  const contents = new TextEncoder().encode("int binaryUnsaved = 0;");
+  for (const unsavedContents of [contents, contents.buffer]) {
+    const tu = clang.parseTranslationUnit(index, "binary.cpp", null, [{ filename: "binary.cpp", contents: unsavedContents }], 0);
+    expect(clang.isNullPointer(tu)).toBeFalsy();
+    const spellings: string[] = [];
+    clang.visitChildren(clang.getTranslationUnitCursor(tu), (c) => {
+      spellings.push(clang.getCursorSpelling(c));
+      return clang.CXChildVisitResult.Continue;
+    });
+    expect(spellings).toContain("binaryUnsaved");
+    clang.disposeTranslationUnit(tu);
+  }
+});
+
+test("Can reparse from an unsaved file store", () => {
+  const store = clang.createUnsavedFileStore();
+  clang.UnsavedFileStore_setContents(store, "store.cpp", "int first = 0;");
+  const tu = clang.parseTranslationUnit(index, "store.cpp", null, store, clang.CXTranslationUnit_Flags.PrecompiledPreamble.value);
+  expect(clang.isNullPointer(tu)).toBeFalsy();
+  expect(clang.UnsavedFileStore_applyEdit(store, "store.cpp", 4, 5, "second")).toBe(true);
+  expect(clang.UnsavedFileStore_applyEdit(store, "store.cpp", 100, 0, "x")).toBe(false);
+  expect(clang.UnsavedFileStore_getContents(store, "store.cpp")).toBe("int second = 0;");
+  expect(clang.reparseTranslationUnit(tu, store, 0)).toBe(0);
+  const spellings: string[] = [];
+  clang.visitChildren(clang.getTranslationUnitCursor(tu), (c) => {
+    spellings.push(clang.getCursorSpelling(c));
+    return clang.CXChildVisitResult.Continue;
+  });
+  expect(spellings).toEqual(["second"]);
+  clang.disposeTranslationUnit(tu);
+  expect(clang.UnsavedFileStore_remove(store, "store.cpp")).toBe(true);
+  expect(clang.UnsavedFileStore_getContents(store, "store.cpp")).toBe(null);
+  expect(() => clang.UnsavedFileStore_getContents(index as any, "store.cpp")).toThrow();
+  clang.disposeUnsavedFileStore(store);
+});
+
+test("Can parse and reparse asynchronously", async () => {
+  const failed = await clang.parseTranslationUnitAsync(index, "nonexistingfile", null, null, 0);
+  expect(failed.errorCode).not.toBe(clang.CXErrorCode.Success.value);
+  expect(clang.isNullPointer(failed.tu)).toBeTruthy();
+  const store = clang.createUnsavedFileStore();
+  clang.UnsavedFileStore_setContents(store, "async.cpp", "int first = 0;");
+  const pending = clang.parseTranslationUnitAsync(index, "async.cpp", null, store, 0);
+  clang.UnsavedFileStore_setContents(store, "async.cpp", "int second = 0;");
+  const { tu, errorCode } = await pending;
+  expect(errorCode).toBe(clang.CXErrorCode.Success.value);
+  const spellings = () => {
+    const ret: string[] = [];
+    clang.visitChildren(clang.getTranslationUnitCursor(tu), (c) => {
+      ret.push(clang.getCursorSpelling(c));
+      return clang.CXChildVisitResult.Continue;
+    });
+    return ret;
+  };
+  expect(spellings()).toEqual(["first"]);
+  const reparsed = clang.reparseTranslationUnitAsync(tu, store, 0);
+  expect(clang.getIndexResourceUsage(index).busyTranslationUnits).toBe(1);
+  expect(await reparsed).toBe(0);
+  expect(clang.getIndexResourceUsage(index).busyTranslationUnits).toBe(0);
+  expect(spellings()).toEqual(["second"]);
+  clang.disposeTranslationUnit(tu);
+  clang.disposeUnsavedFileStore(store);
+});
+
+test("Rejects changes to translation units with pending jobs", async () => {
+  const unsavedFiles = [{ filename: "pending.cpp", contents: "int pending = 0;" }];
+  const tu = clang.parseTranslationUnit(index, "pending.cpp", null, unsavedFiles, 0);
+  const store = clang.createUnsavedFileStore();
+  clang.UnsavedFileStore_setContents(store, "pending.cpp", "int reparsed = 0;");
+  const reparsed = clang.reparseTranslationUnitAsync(tu, store, 0);
+  expect(clang.reparseTranslationUnit(tu, unsavedFiles, 0)).toBe(clang.CXErrorCode.InvalidArguments.value);
+  expect(await clang.reparseTranslationUnitAsync(tu, store, 0)).toBe(clang.CXErrorCode.InvalidArguments.value);
+  expect(clang.suspendTranslationUnit(tu)).toBe(0);
+  expect(await reparsed).toBe(0);
+  expect(clang.suspendTranslationUnit(tu)).not.toBe(0);
+
+  const usage = clang.getIndexResourceUsage(index).translationUnits;
+  const disposed = clang.reparseTranslationUnitAsync(tu, store, 0);
+  clang.disposeTranslationUnit(tu);
+  expect(clang.getIndexResourceUsage(index).busyTranslationUnits).toBe(1);
+  expect(await disposed).toBe(0);
+  expect(clang.getIndexResourceUsage(index)).toMatchObject({ translationUnits: usage - 1, busyTranslationUnits: 0 });
+  clang.disposeUnsavedFileStore(store);
+});
+
+test("Does not exhaust the thread pool with many asynchronous jobs", async () => {
+  const files = Array.from({ length: 16 }, (_, i) => ({ filename: `queued${i}.cpp`, contents: `int queued${i};` }));
+  const parsed = files.map((f) => clang.parseTranslationUnitAsync(index, f.filename, null, null, 0));
+  const many = clang.parseMany(
+    index,
+    files.map((f) => ({ file: f.filename, args: [], unsavedFiles: [f] })),
+    { threads: 64 }
+  );
+  const results = [...(await Promise.all(parsed)), ...(await many)];
+  expect(results.length).toBe(2 * files.length);
+  results.forEach((r) => {
+    if (!clang.isNullPointer(r.tu)) clang.disposeTranslationUnit(r.tu);
+  });
+  expect(results.slice(files.length).every((r) => r.errorCode === clang.CXErrorCode.Success.value)).toBeTruthy();
+});
+
+test("Can parse many translation units in parallel", async () => {
+  const files = Array.from({ length: 8 }, (_, i) => ({ filename: `many${i}.cpp`, contents: `int many${i} = ${i};` }));
+  const jobs = files.map((f) => ({ file: f.filename, args: [], unsavedFiles: [f] }));
+  jobs.push({ file: "nonexistingfile", args: [], unsavedFiles: [] });
+  const results = await clang.parseMany(index, jobs, { threads: 3 });
+  expect(results.length).toBe(jobs.length);
+  files.forEach((f, i) => {
+    expect(results[i].errorCode).toBe(clang.CXErrorCode.Success.value);
+    const spellings: string[] = [];
+    clang.visitChildren(clang.getTranslationUnitCursor(results[i].tu), (c) => {
+      spellings.push(clang.getCursorSpelling(c));
+      return clang.CXChildVisitResult.Continue;
+    });
+    expect(spellings).toEqual([`many${i}`]);
+    clang.disposeTranslationUnit(results[i].tu);
+  });
+  expect(results[files.length].errorCode).not.toBe(clang.CXErrorCode.Success.value);
+});
+
+test("Can cache translation units within a memory budget", () => {
+  const unsavedFiles = ["cachedA.cpp", "cachedB.cpp"].map((filename) => ({ filename, contents: "int cached = 0;" }));
+  const spellings = (tu: CXTranslationUnit) => {
+    const ret: string[] = [];
+    clang.visitChildren(clang.getTranslationUnitCursor(tu), (c) => {
+      ret.push(clang.getCursorSpelling(c));
+      return clang.CXChildVisitResult.Continue;
+    });
+    return ret;
+  };
+  const roomyCache = clang.createTranslationUnitCache(index, 1 << 30);
+  for (let i = 0; i < 3; i++) {
+    const tu = clang.TranslationUnitCache_get(roomyCache, "cachedA.cpp", null, unsavedFiles, 0);
+    expect(clang.isNullPointer(tu)).toBeFalsy();
+    expect(clang.TranslationUnitCache_release(roomyCache, tu)).toBe(true);
+  }
+  clang.TranslationUnitCache_get(roomyCache, "cachedA.cpp", ["-DOTHER"], unsavedFiles, 0);
+  const roomyStats = clang.TranslationUnitCache_getStats(roomyCache);
+  expect(roomyStats).toMatchObject({ entries: 2, pinnedEntries: 1, hits: 2, misses: 2, suspensions: 0, evictions: 0 });
+  expect(roomyStats.bytes).toBeGreaterThan(0);
+  const edited = clang.TranslationUnitCache_get(roomyCache, "cachedA.cpp", null, [{ filename: "cachedA.cpp", contents: "int edited = 0;" }], 0);
+  expect(spellings(edited)).toEqual(["edited"]);
+  expect(clang.TranslationUnitCache_getStats(roomyCache)).toMatchObject({ entries: 2, hits: 3 });
+  // The edited translation unit is in use, so it is not reparsed.
+  const separate = clang.TranslationUnitCache_get(roomyCache, "cachedA.cpp", null, unsavedFiles, 0);
+  expect(spellings(separate)).toEqual(["cached"]);
+  expect(spellings(edited)).toEqual(["edited"]);
+  expect(clang.TranslationUnitCache_getStats(roomyCache)).toMatchObject({ entries: 2, hits: 3, misses: 3 });
+  expect(clang.TranslationUnitCache_release(roomyCache, separate)).toBe(true);
+  expect(clang.TranslationUnitCache_release(roomyCache, separate)).toBe(false);
+  clang.disposeTranslationUnitCache(roomyCache);
+
+  const tightCache = clang.createTranslationUnitCache(index, 0);
+  expect(clang.isNullPointer(clang.TranslationUnitCache_get(tightCache, "nonexistingfile", null, null, 0))).toBeTruthy();
+  const tuA = clang.TranslationUnitCache_get(tightCache, "cachedA.cpp", null, unsavedFiles, 0);
+  const tuB = clang.TranslationUnitCache_get(tightCache, "cachedB.cpp", null, unsavedFiles, 0);
+  // Translation units in use are kept beyond the budget.
+  expect(clang.TranslationUnitCache_getStats(tightCache)).toMatchObject({ entries: 2, pinnedEntries: 2, suspensions: 0, evictions: 0 });
+  expect(spellings(tuA)).toEqual(["cached"]);
+  expect(clang.TranslationUnitCache_release(tightCache, tuA)).toBe(true);
+  expect(clang.TranslationUnitCache_release(tightCache, tuA)).toBe(false);
+  expect(clang.getCursorSpelling(clang.getTranslationUnitCursor(tuB))).toBe("cachedB.cpp");
+  const tightStats = clang.TranslationUnitCache_getStats(tightCache);
+  expect(tightStats).toMatchObject({ entries: 1, pinnedEntries: 1, misses: 3, suspensions: 1, evictions: 1 });
+  clang.disposeTranslationUnitCache(tightCache);
+});
+
+test("Can report the memory usage of translation units", () => {
+  const usageIndex = clang.createIndex(0, 0);
+  const unsavedFiles = [{ filename: "usage.cpp", contents: "struct Usage { int a; };" }];
+  const tus = [0, 1].map(() => clang.parseTranslationUnit(usageIndex, "usage.cpp", null, unsavedFiles, 0));
+  const usage = clang.getTUResourceUsage(tus[0]);
+  expect(usage.kind.length).toBe(usage.bytes.length);
+  expect(usage.kind).toContain(clang.CXTUResourceUsageKind.AST.value);
+  const sum = (bytes: Float64Array) => bytes.reduce((a, b) => a + b, 0);
+  const total = clang.getIndexResourceUsage(usageIndex);
+  expect(total.translationUnits).toBe(2);
+  expect(sum(total.bytes)).toBe(sum(usage.bytes) + sum(clang.getTUResourceUsage(tus[1]).bytes));
+  tus.forEach((tu) => clang.disposeTranslationUnit(tu));
+  expect(clang.getIndexResourceUsage(usageIndex).translationUnits).toBe(0);
+  clang.disposeIndex(usageIndex);
+});
+
+test("Can complete code", () => {
+  const unsavedFiles = [{ filename: "complete.cpp", contents: "struct S { int alpha; int alphabet; int beta; };\nvoid f(S s) {\n  s.al\n}\n" }];
+  const tu = clang.parseTranslationUnit(index, "complete.cpp", null, unsavedFiles, 0);
+  const typedTexts = (completions: ReturnType<typeof clang.codeCompleteAt>) => Array.from({ length: completions.length }, (_, i) => {
+    for (let j = completions.chunkOffsets[i]; j < completions.chunkOffsets[i + 1]; j++) {
+      if (completions.chunkKind[j] === clang.CXCompletionChunkKind.TypedText.value) {
+        return completions.strings[completions.chunkText[j]];
+      }
+    }
+  });
+  const all = clang.codeCompleteAt(tu, "complete.cpp", 3, 5, unsavedFiles, clang.defaultCodeCompleteOptions(), "al", 10);
+  expect(all.matches).toBe(2);
+  expect(typedTexts(all)).toEqual(["alpha", "alphabet"]);
+  expect(all.cursorKind[0]).toBe(clang.CXCursorKind.FieldDecl.value);
+  const limited = clang.codeCompleteAt(tu, "complete.cpp", 3, 5, unsavedFiles, clang.defaultCodeCompleteOptions(), "AL", 1);
+  expect(limited.matches).toBe(2);
+  expect(typedTexts(limited)).toEqual(["alpha"]);
+  clang.disposeTranslationUnit(tu);
+});
+
+test("Can narrow code completion results while typing", () => {
+  const unsavedFiles = [{ filename: "session.cpp", contents: "struct S { int alpha; int alphabet; int beta; };\nvoid f(S s) {\n  s.\n}\n" }];
+  const tu = clang.parseTranslationUnit(index, "session.cpp", null, unsavedFiles, clang.CXTranslationUnit_Flags.CacheCompletionResults.value);
+  const session = clang.createCodeCompletionSession(tu, "session.cpp", 3, 5, unsavedFiles, clang.defaultCodeCompleteOptions());
+  expect(clang.CodeCompletionSession_filter(session, 3, 5, "", 100)?.matches).toBeGreaterThanOrEqual(3);
+  expect(clang.CodeCompletionSession_filter(session, 3, 6, "a", 100)?.matches).toBe(2);
+  expect(clang.CodeCompletionSession_filter(session, 3, 11, "alphab", 100)?.matches).toBe(1);
+  expect(clang.CodeCompletionSession_filter(session, 3, 10, "alphab", 100)).toBe(null);
+  expect(clang.CodeCompletionSession_filter(session, 3, 11, "alpha(", 100)).toBe(null);
+  expect(clang.CodeCompletionSession_filter(session, 4, 1, "", 100)).toBe(null);
+  clang.disposeCodeCompletionSession(session);
+  clang.disposeTranslationUnit(tu);
+});
+
+test("Passes cursors, types, locations and ranges as plain objects", () => {
+  const cursor = clang.getTranslationUnitCursor(tu);
+  const copy = JSON.parse(JSON.stringify({ ...cursor, kind: undefined }));
+  copy.kind = cursor.kind;
+  expect(clang.equalCursors(copy, cursor)).not.toBe(0);
+  // Kept for callers written for the former class handles.
+  expect(() => (cursor as any).delete()).not.toThrow();
+  expect(clang.equalCursors(cursor, clang.getTranslationUnitCursor(tu))).not.toBe(0);
+  const range = clang.getCursorExtent(cursor);
+  expect(clang.equalLocations({ ...clang.getRangeStart(range) }, clang.getRangeStart(range))).not.toBe(0);
+  const visit = () => clang.visitChildren(cursor, (c) => {
+    clang.getCursorLocation(c);
+    clang.getCursorExtent(c);
+    clang.getTypeSpelling(clang.getCursorType(c));
+    return clang.CXChildVisitResult.Recurse;
+  });
+  visit();
+  const inUse = clang.getHeapStats().inUseBytes;
+  for (let i = 0; i < 20; i++) {
+    visit();
+  }
+  expect(clang.getHeapStats().inUseBytes).toBe(inUse);
+});
+
+test("Can use the raw accessors", () => {
+  const raw = clang.raw;
+  const cursorSize = raw.sizeofCursor();
+  const root = raw.malloc(cursorSize);
+  raw.getTranslationUnitCursor(clang.getPointerAddress(tu), root);
+  expect(raw.getCursorKind(root)).toBe(clang.CXCursorKind.TranslationUnit.value);
+  // Unsigned results are not wrapped around to negative numbers.
+  for (let i = 0; i < 2; i++) {
+    expect(raw.hashCursor(root)).toBe(clang.hashCursor(clang.getTranslationUnitCursor(tu)));
+  }
+  const expected: string[] = [];
+  let firstLocation: ReturnType<typeof clang.getSpellingLocation> | undefined;
+  clang.visitChildren(clang.getTranslationUnitCursor(tu), (c) => {
+    expected.push(clang.getCursorSpelling(c) ?? "");
+    firstLocation ??= clang.getSpellingLocation(clang.getCursorLocation(c));
+    return clang.CXChildVisitResult.Continue;
+  });
+  const count = raw.getChildren(root, 0, 0);
+  expect(count).toBe(expected.length);
+  const children = raw.malloc(count * cursorSize);
+  expect(raw.getChildren(root, children, count)).toBe(count);
+  const spellings = Array.from({ length: count }, (_, i) => raw.string(raw.getCursorSpelling(children + i * cursorSize)));
+  expect(spellings).toEqual(expected);
+  const location = raw.malloc(raw.sizeofSourceLocation());
+  const position = raw.malloc(16);
+  raw.getCursorLocation(children, location);
+  raw.getSpellingLocation(location, position);
+  const [file, line, column] = raw.HEAPU32().subarray(position / 4, position / 4 + 3);
+  expect(raw.string(raw.getFileName(file))).toBe(clang.getFileName(firstLocation!.file));
+  expect([line, column]).toEqual([firstLocation!.line, firstLocation!.column]);
+  [root, children, location, position].forEach(raw.free);
+});
+
+test("Raw accessors agree with the embind functions", () => {
+  const raw = clang.raw;
+  const source = "typedef int Number;\nstatic Number add(Number a, char b) { return a + b; }\n";
+  const rawTu = clang.parseTranslationUnit(index, "raw.cpp", null, [{ filename: "raw.cpp", contents: source }], 0);
+  expect(clang.isNullPointer(rawTu)).toBeFalsy();
+  const argument = raw.malloc(raw.sizeofCursor());
+  const type = raw.malloc(raw.sizeofType());
+  const other = raw.malloc(raw.sizeofType());
+  const location = raw.malloc(raw.sizeofSourceLocation());
+  const otherLocation = raw.malloc(raw.sizeofSourceLocation());
+  const range = raw.malloc(raw.sizeofSourceRange());
+  const otherRange = raw.malloc(raw.sizeofSourceRange());
+  const position = raw.malloc(8);
+  const root = raw.malloc(raw.sizeofCursor());
+  raw.getTranslationUnitCursor(clang.getPointerAddress(rawTu), root);
+  const count = raw.getChildren(root, 0, 0);
+  const children = raw.malloc(count * raw.sizeofCursor());
+  raw.getChildren(root, children, count);
+  const cursors: CXCursor[] = [];
+  clang.visitChildren(clang.getTranslationUnitCursor(rawTu), (c) => {
+    cursors.push(c);
+    return clang.CXChildVisitResult.Continue;
+  });
+  expect(cursors.map((c) => clang.getCursorSpelling(c))).toEqual(["Number", "add"]);
+  cursors.forEach((c, i) => {
+    const rawCursor = children + i * raw.sizeofCursor();
+    const kind = clang.getCursorKind(c);
+    expect(raw.isDeclaration(kind.value)).toBe(clang.isDeclaration(kind));
+    expect(raw.isReference(kind.value)).toBe(clang.isReference(kind));
+    expect(raw.isExpression(kind.value)).toBe(clang.isExpression(kind));
+    expect(raw.getCursorLinkage(rawCursor)).toBe(clang.getCursorLinkage(c).value);
+    raw.getCursorResultType(rawCursor, type);
+    expect(raw.getTypeKind(type)).toBe(clang.getCursorResultType(c).kind.value);
+    raw.getTypedefDeclUnderlyingType(rawCursor, type);
+    expect(raw.getTypeKind(type)).toBe(clang.getTypedefDeclUnderlyingType(c).kind.value);
+    raw.getCursorLocation(rawCursor, location);
+    expect(raw.Location_isFromMainFile(location)).toBe(clang.Location_isFromMainFile(clang.getCursorLocation(c)));
+    const presumed = clang.getPresumedLocation(clang.getCursorLocation(c));
+    expect(raw.string(raw.getPresumedLocation(location, position))).toBe(presumed.filename);
+    expect(Array.from(raw.HEAPU32().subarray(position / 4, position / 4 + 2))).toEqual([presumed.line, presumed.column]);
+  });
+
+  const add = children + raw.sizeofCursor();
+  const numArguments = raw.Cursor_getNumArguments(add);
+  expect(numArguments).toBe(clang.Cursor_getNumArguments(cursors[1]));
+  raw.getCursorType(add, type);
+  expect(raw.getNumArgTypes(type)).toBe(clang.getNumArgTypes(clang.getCursorType(cursors[1])));
+  for (let i = 0; i < numArguments; i++) {
+    raw.Cursor_getArgument(add, i, argument);
+    expect(raw.string(raw.getCursorSpelling(argument))).toBe(clang.getCursorSpelling(clang.Cursor_getArgument(cursors[1], i)));
+    raw.getArgType(type, i, other);
+    expect(raw.string(raw.getTypeSpelling(other))).toBe(clang.getTypeSpelling(clang.getArgType(clang.getCursorType(cursors[1]), i)));
+  }
+  const addType = clang.getCursorType(cursors[1]);
+  for (const i of [0, 1]) {
+    raw.getCursorType(add, other);
+    raw.getArgType(other, 0, type);
+    raw.getArgType(other, i, other);
+    expect(raw.equalTypes(type, other)).toBe(clang.equalTypes(clang.getArgType(addType, 0), clang.getArgType(addType, i)));
+  }
+
+  raw.getCursorLocation(children, location);
+  raw.getCursorExtent(children, range);
+  for (const i of [0, 1]) {
+    raw.getCursorLocation(children + i * raw.sizeofCursor(), otherLocation);
+    raw.getCursorExtent(children + i * raw.sizeofCursor(), otherRange);
+    expect(raw.equalLocations(location, otherLocation)).toBe(clang.equalLocations(clang.getCursorLocation(cursors[0]), clang.getCursorLocation(cursors[i])));
+    expect(raw.equalRanges(range, otherRange)).toBe(clang.equalRanges(clang.getCursorExtent(cursors[0]), clang.getCursorExtent(cursors[i])));
+  }
+
+  [argument, type, other, location, otherLocation, range, otherRange, position, root, children].forEach(raw.free);
+  clang.disposeTranslationUnit(rawTu);
+});
+
+test("Can get heap statistics", () => {
+  const stats = clang.getHeapStats();
+  expect(stats.heapSize).toBe(clang.HEAP8.length);
+  expect(stats.heapSize).toBeLessThanOrEqual(stats.heapMax);
+  expect(stats.inUseBytes).toBeGreaterThan(0);
+  expect(stats.inUseBytes + stats.freeBytes).toBeLessThanOrEqual(stats.heapSize);
+  expect(stats.fragmentation).toBeGreaterThanOrEqual(0);
+  expect(stats.fragmentation).toBeLessThanOrEqual(1);
+});
+
+test("Can profile bound functions", async () => {
+  clang.getCursorSpelling(clang.getTranslationUnitCursor(tu));
+  expect(clang.getBindingProfile()).toEqual([]);
+  const profiled = await init({ libclangjsProfiling: true });
+  const profiledIndex = profiled.createIndex(0, 0);
+  const profiledTu = profiled.parseTranslationUnit(profiledIndex, "profiled.cpp", null, [{ filename: "profiled.cpp", contents: "int a; int b; int c;" }], 0);
+  profiled.visitChildren(profiled.getTranslationUnitCursor(profiledTu), (c) => {
+    profiled.getCursorSpelling(c);
+    return profiled.CXChildVisitResult.Continue;
+  });
+  profiled.disposeTranslationUnit(profiledTu);
+  profiled.disposeIndex(profiledIndex);
+  const profile = profiled.getBindingProfile();
+  const entry = (name: string) => profile.find((e) => e.name === name);
+  expect(entry("getCursorSpelling")?.calls).toBe(3);
+  expect(entry("parseTranslationUnit")?.bytes).toBeGreaterThan(0);
+  const visitChildren = entry("visitChildren")!;
+  expect(visitChildren.calls).toBe(1);
+  expect(visitChildren.selfTime).toBeLessThanOrEqual(visitChildren.totalTime);
+  expect(profiled.getBindingTrace().traceEvents.length).toBe(profile.reduce((n, e) => n + e.calls, 0));
+  profiled.resetBindingProfile();
+  expect(profiled.getBindingProfile()).toEqual([]);
+  profiled.PThread.terminateAllThreads();
+});
+
 test("Can shutdown all threads", () => {
   clang.PThread.terminateAllThreads();
 });